@@ -0,0 +1,79 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/asset.hpp>
+#include <eosio/datastream.hpp>
+
+using namespace eosio;
+
+// --- fixed capacity text formatter for transfer memos, never touches the heap.
+//     serialized the same as string, so it can be packed into action data directly
+template<size_t N>
+class FixedFmt {
+  public:
+    FixedFmt() { _buf[0] = '\0'; }
+
+    FixedFmt& operator<<(const char* str) {
+      while ( *str ) _put( *str++ );
+      _buf[_len] = '\0';
+      return *this;
+    }
+
+    FixedFmt& operator<<(const asset& quantity) {
+      char* end = quantity.write_as_string( _buf + _len, _buf + N );
+      check( end <= _buf + N, "memo buffer overflow" );
+      _len = end - _buf;
+      _buf[_len] = '\0';
+      return *this;
+    }
+
+    const char* c_str() const { return _buf; }
+    size_t size() const { return _len; }
+
+    template<typename DataStream>
+    friend DataStream& operator<<(DataStream& ds, const FixedFmt& fmt) {
+      ds << unsigned_int( fmt._len );
+      ds.write( fmt._buf, fmt._len );
+      return ds;
+    }
+
+  private:
+    void _put(char c) {
+      check( _len < N, "memo buffer overflow" );
+      _buf[_len++] = c;
+    }
+
+    char    _buf[N + 1];
+    size_t  _len = 0;
+};
+
+// --- bump arena for action payloads: carved from static memory, released with the wasm instance after the action
+template<size_t N>
+class BumpArena {
+  public:
+    char* alloc(size_t size) {
+      check( _used + size <= N, "action payload arena exhausted" );
+      char* p = _buf + _used;
+      _used += size;
+      return p;
+    }
+
+    // hand back the latest allocation once its content has been consumed
+    void release(size_t size) {
+      _used -= size;
+    }
+
+  private:
+    alignas(8) char _buf[N];
+    size_t          _used = 0;
+};
+
+#ifdef DEBUG_PRINT
+extern "C" char __heap_base;
+
+// heap used by the action so far; malloc is a bump allocator that never frees, so this is also the peak
+inline uint32_t heap_peak() {
+  char* top = static_cast<char*>( malloc( 1 ) );
+  return static_cast<uint32_t>( top - &__heap_base );
+}
+#endif
@@ -1,6 +1,11 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/system.hpp>
+#include <eosio/crypto.hpp>
+#include <eosio/binary_extension.hpp>
+#include <Storage.hpp>
+#include <RamCost.hpp>
+#include <FixedBuffer.hpp>
 
 using namespace eosio;
 using namespace std;
@@ -18,9 +23,41 @@ CONTRACT InheritAgent : public contract {
 
     ACTION minerclaim(const name& miner);
 
+    ACTION payout(const name& role, const name& cursor, uint32_t limit, const asset& min_amount);
+
     ACTION mine(const name& inheritor, const name& tokencontract, const asset& quantity,
                 const name& assetclient, const name& miner);
 
+    ACTION reserve(const name& inheritor, const name& tokencontract, const asset& quantity,
+                   const name& assetclient, const name& miner);
+
+    ACTION release(const name& assetclient, uint64_t id, const name& caller);
+
+    ACTION sethost(const name& client, const name& host);
+
+    ACTION migratebill(uint32_t limit);
+
+    ACTION getbills(const name& account, const name& role, uint64_t from, uint32_t limit);
+
+    // --- constant cost solvency: the agent's token balance against the totals it owes
+    ACTION solvency();
+
+    ACTION tallytotals(const name& role, bool restart, uint32_t limit);
+
+    // --- read only: RAM this contract would pay for count inheritances of the client mined by the miner
+    ACTION estimate(const name& assetclient, const name& miner, uint32_t count);
+
+    // --- deposit distribution list, referred by transfer memo "list:<id>"
+    struct DistEntry {
+      name      account;
+      name      role;       // "miner" or "client"
+      asset     quantity;
+    };
+
+    ACTION setdistlist(const name& sponsor, uint64_t id, const vector<DistEntry>& entries);
+
+    ACTION rmdistlist(const name& sponsor, uint64_t id);
+
     // --- notification response
     [[eosio::on_notify("eosio.token::transfer")]]
     void ondeposit(const name& from, const name& to, const asset& quantity, const string& memo);
@@ -32,18 +69,54 @@ CONTRACT InheritAgent : public contract {
 #ifdef DEBUG
     ACTION cleardata();
     ACTION printtime();
+    ACTION benchbill(uint32_t count);
 #endif
 
   private:
+    // running totals of what the agent owes, kept up by every change of miner and client balances
+    struct Totals {
+      asset     minerDeposits;
+      asset     minerRewards;
+      asset     minerFees;      // mining fines collected
+      asset     clientRefunds;
+      asset     clientFees;     // service charges collected
+      uint64_t  minerCursor;    // tally in progress: only miners below are counted; UINT64_MAX once all are
+      uint64_t  clientCursor;
+    };
+
     // self variables
     TABLE SelfVar {
       uint64_t  key;
       bool      enabled;
       asset     earnings;
+      binary_extension<Totals> totals;  // missing on agents initialized before the totals, see tallytotals
       uint64_t  primary_key() const { return key; }
+      static constexpr uint32_t fixed_size = 25;    // serialized bytes without totals, see RamCost.hpp
     };
     typedef eosio::multi_index<"selfvar"_n, SelfVar> SelfVarIndex;
 
+    // changes of the agent's earnings and totals made by one action, gathered here and written to selfvar
+    // by a single modify in post()
+    class Books {
+      public:
+        explicit Books(const name& self);
+        void miner(const name& miner, const symbol& sym, int64_t deposit, int64_t reward, int64_t fee);
+        void client(const name& client, const symbol& sym, int64_t refund, int64_t fee);
+        void earn(const asset& quantity);
+        void post();
+
+      private:
+        SelfVarIndex                 selfVar;
+        SelfVarIndex::const_iterator varItr;
+        int64_t   minerDeposits = 0;
+        int64_t   minerRewards = 0;
+        int64_t   minerFees = 0;
+        int64_t   clientRefunds = 0;
+        int64_t   clientFees = 0;
+        int64_t   earnings = 0;
+        bool      changed = false;
+    };
+
     // --- miner data
     TABLE MinerData {  // scoped by self
       name      miner;
@@ -54,10 +127,11 @@ CONTRACT InheritAgent : public contract {
       uint32_t  lastTryTime;
       uint32_t  lastClaimTime;
       uint64_t  primary_key() const { return miner.value; }
+      static constexpr uint32_t fixed_size = 65;
     };
     typedef eosio::multi_index<"minerdata"_n, MinerData> MinerDataIndex;
 
-    // --- miner bill
+    // --- miner bill, legacy table only read by migratebill
     TABLE MinerBill {  // scoped by self
       uint64_t  id;
       name      payer;
@@ -66,6 +140,7 @@ CONTRACT InheritAgent : public contract {
       uint8_t   type;
       uint32_t  date;
       uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 45;
     };
     typedef eosio::multi_index<"minerbill"_n, MinerBill> MinerBillIndex;
 
@@ -77,10 +152,11 @@ CONTRACT InheritAgent : public contract {
       asset     refund;
       uint32_t  lastClaimTime;
       uint64_t  primary_key() const { return client.value; }
+      static constexpr uint32_t fixed_size = 60;
     };
     typedef eosio::multi_index<"clientdata"_n, ClientData> ClientDataIndex;
 
-    // --- client bill
+    // --- client bill, legacy table only read by migratebill
     TABLE ClientBill {  // scoped by self
       uint64_t  id;
       name      payer;
@@ -89,9 +165,113 @@ CONTRACT InheritAgent : public contract {
       uint8_t   type;
       uint32_t  date;
       uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 45;
     };
     typedef eosio::multi_index<"clientbill"_n, ClientBill> ClientBillIndex;
 
+    // --- bill of one miner or client account, indexed by (account, date) for statements
+    TABLE Bill {  // scoped by self
+      uint64_t  id;
+      name      account;    // the miner or client the bill belongs to
+      name      payer;
+      name      payee;
+      asset     quantity;
+      uint8_t   type;
+      uint32_t  date;
+      uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 53;
+      uint128_t get_acct_bill() const { return acct_bill( account, ( static_cast<uint64_t>(date) << 32 ) | ( id & 0xffffffff ) ); }
+      static uint128_t acct_bill(const name& account, uint64_t cursor) { return ( static_cast<uint128_t>(account.value) << 64 ) | cursor; }
+    };
+    typedef eosio::multi_index<
+      "minerbills"_n, Bill,
+      indexed_by<"acctbill"_n, const_mem_fun<Bill, uint128_t, &Bill::get_acct_bill>>
+      > MinerBillsIndex;
+    typedef eosio::multi_index<
+      "clientbills"_n, Bill,
+      indexed_by<"acctbill"_n, const_mem_fun<Bill, uint128_t, &Bill::get_acct_bill>>
+      > ClientBillsIndex;
+
+    // storage traits of the bills, see Storage.hpp
+    struct MinerBillRows {
+      using row = Bill;
+      using index = MinerBillsIndex;
+      using sort_key = uint128_t;
+      static constexpr name::raw table = "minerbills"_n;
+      static constexpr name::raw sort_index = "acctbill"_n;
+      static sort_key sort_of(const row& r) { return r.get_acct_bill(); }
+    };
+    struct ClientBillRows {
+      using row = Bill;
+      using index = ClientBillsIndex;
+      using sort_key = uint128_t;
+      static constexpr name::raw table = "clientbills"_n;
+      static constexpr name::raw sort_index = "acctbill"_n;
+      static sort_key sort_of(const row& r) { return r.get_acct_bill(); }
+    };
+
+    // --- batch payout settlement, one row per payout page
+    TABLE Settlement {  // scoped by self
+      uint64_t  id;
+      name      role;
+      name      firstAccount;
+      name      lastAccount;
+      uint32_t  count;
+      asset     total;
+      uint32_t  date;
+      uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 56;
+    };
+    typedef eosio::multi_index<"settlement"_n, Settlement> SettlementIndex;
+
+    // --- mining lease: a miner reserves a due inheritance for a short window
+    TABLE MiningLease {  // scoped by asset client
+      uint64_t  id;
+      name      inheritor;
+      name      tokencontract;
+      symbol    sym;
+      name      miner;
+      uint32_t  expireTime;
+      uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 44;
+      uint128_t get_inherit_symc() const { return ( static_cast<uint128_t>(inheritor.value) << 64 ) | sym.code().raw(); }
+    };
+    typedef eosio::multi_index<
+      "mininglease"_n, MiningLease,
+      indexed_by<"inheritsymc"_n, const_mem_fun<MiningLease, uint128_t, &MiningLease::get_inherit_symc>>
+      > MiningLeaseIndex;
+
+    // --- shared client contract hosting the client (no row when the client deploys its own)
+    TABLE ClientHost {  // scoped by self
+      name      client;
+      name      host;
+      uint64_t  primary_key() const { return client.value; }
+      static constexpr uint32_t fixed_size = 16;
+    };
+    typedef eosio::multi_index<"clienthost"_n, ClientHost> ClientHostIndex;
+
+    // --- deposit distribution list
+    TABLE DistList {  // scoped by sponsor
+      uint64_t          id;
+      vector<DistEntry> entries;
+      uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 8;
+      static constexpr uint32_t packed_size(uint32_t entryCount) { return fixed_size + ramcost::vector_size( entryCount, 32 ); }
+    };
+    typedef eosio::multi_index<"distlist"_n, DistList> DistListIndex;
+
+    // --- indexing external table of client's global flag, the epoch offset postpones its inheritances
+    TABLE GlobalFlag {  // scoped by 0 for the contract account itself, by owner in shared client contract
+      uint64_t  key;
+      bool      miningEnabled;
+      binary_extension<uint8_t> layout;
+      binary_extension<uint32_t> epochOffset;
+      binary_extension<uint32_t> lastBeat;
+      uint64_t  primary_key() const { return key; }
+      static constexpr uint32_t fixed_size = 9;     // without the extensions, 9 more bytes with all of them
+    };
+    typedef eosio::multi_index<"globalflag"_n, GlobalFlag> GlobalFlagIndex;
+
     // --- indexing external table of inheritance records
     typedef uint8_t State;
     TABLE Inheritance { // scoped by inheritor
@@ -104,6 +284,8 @@ CONTRACT InheritAgent : public contract {
       string          remark;
       uint64_t  primary_key() const { return id; }
       uint64_t  get_token_code() const { return willGet.contract.value; }
+      static constexpr uint32_t fixed_size = 45;
+      static constexpr uint32_t packed_size(uint32_t remarkLen) { return fixed_size + ramcost::string_size( remarkLen ); }
       uint64_t  get_token_symc() const { return willGet.quantity.symbol.code().raw(); }
       uint128_t get_unique_tkn() const { return ( static_cast<uint128_t>(get_token_code()) << 64 ) | get_token_symc(); }
       uint64_t  get_valid_from() const { return static_cast<uint64_t>(validFrom); }
@@ -116,7 +298,68 @@ CONTRACT InheritAgent : public contract {
       indexed_by<"validfrom"_n, const_mem_fun<Inheritance, uint64_t, &Inheritance::get_valid_from>>
       > InheritanceIndex;
 
+    // --- indexing external table of inheritance records in shared client contract
+    TABLE TntInherit { // scoped by owner
+      uint64_t        id;
+      name            inheritor;
+      State           state;
+      extended_asset  willGet;
+      uint32_t        validFrom;
+      uint32_t        cdBeganTime;
+      uint32_t        cdDuration;
+      string          remark;
+      binary_extension<uint16_t> shareBps;  // share mode: basis points of the unallocated balance, willGet amount 0
+      uint64_t    primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 53;    // without shareBps, 2 more bytes on share rows
+      static constexpr uint32_t packed_size(uint32_t remarkLen, bool share) {
+        return fixed_size + ramcost::string_size( remarkLen ) + ( share ? 2 : 0 );
+      }
+      uint64_t    get_token_code() const { return willGet.contract.value; }
+      uint64_t    get_token_symc() const { return willGet.quantity.symbol.code().raw(); }
+      checksum256 get_inherit_tkn() const { return inherit_tkn( inheritor, willGet.contract, willGet.quantity.symbol.code() ); }
+      uint64_t    get_valid_from() const { return static_cast<uint64_t>(validFrom); }
+      static checksum256 inherit_tkn(const name& inheritor, const name& tokencontract, const symbol_code& symc) {
+        return checksum256::make_from_word_sequence<uint64_t>( inheritor.value, tokencontract.value, symc.raw(), 0ULL );
+      }
+    };
+    typedef eosio::multi_index<
+      "tinherit"_n, TntInherit,
+      indexed_by<"tokencode"_n, const_mem_fun<TntInherit, uint64_t, &TntInherit::get_token_code>>,
+      indexed_by<"tokensymc"_n, const_mem_fun<TntInherit, uint64_t, &TntInherit::get_token_symc>>,
+      indexed_by<"inherittkn"_n, const_mem_fun<TntInherit, checksum256, &TntInherit::get_inherit_tkn>>,
+      indexed_by<"validfrom"_n, const_mem_fun<TntInherit, uint64_t, &TntInherit::get_valid_from>>
+      > TntInheritIndex;
+
+    // storage traits of the inheritance records, see Storage.hpp
+    struct TntInheritRows {
+      using row = TntInherit;
+      using index = TntInheritIndex;
+      using key = checksum256;
+      static constexpr name::raw table = "tinherit"_n;
+      static constexpr name::raw key_index = "inherittkn"_n;
+      static key key_of(const row& r) { return r.get_inherit_tkn(); }
+    };
+
+    // --- for indexing external table in eosio.token
+    struct Account {  // same as the struct in eosio.token
+      asset balance;
+      uint64_t primary_key() const { return balance.symbol.code().raw(); }
+    };
+    typedef eosio::multi_index<"accounts"_n, Account> AccountIndex;
+
     // --- helper methods
     uint32_t _timenow() const { return current_time_point().sec_since_epoch(); }
-    void _earn(const asset& quantity);
+    void _credit(MinerDataIndex& minerData, ClientDataIndex& clientData, Books& books,
+                 const name& role, const name& account, const asset& quantity);
+    void _bulkdeposit(const name& from, const asset& quantity, const string& memo);
+    void _listdeposit(const name& from, const asset& quantity, const string& memo);
+    template<typename... Args>
+    void _sendInline(const name& contract, const name& act, const Args&... args);
+    name _hostOf(const name& assetclient) const;
+    bool _getInheritance(const name& assetclient, const name& inheritor, const name& tokencontract,
+                         const symbol_code& symc, Inheritance& inheritance) const;
+    int64_t _heldRefund(const name& assetclient, int64_t refund) const;
+    MiningLeaseIndex::const_iterator _findLease(const MiningLeaseIndex& leases, const name& inheritor,
+                                                const name& tokencontract, const symbol_code& symc) const;
+    void _fineIdleLease(MinerDataIndex& minerData, const MiningLease& lease, uint32_t now);
 };
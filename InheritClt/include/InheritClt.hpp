@@ -1,6 +1,10 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/system.hpp>
+#include <eosio/crypto.hpp>
+#include <Storage.hpp>
+#include <RamCost.hpp>
+#include <eosio/binary_extension.hpp>
 
 using namespace eosio;
 using namespace std;
@@ -18,15 +22,60 @@ CONTRACT InheritClt : public contract {
     ACTION allocate(const name& inheritor, const name& tokencontract, const asset& quantity,
                     uint32_t validFrom, uint32_t cdDuration, const string& remark);
 
+    ACTION allocshare(const name& inheritor, const name& tokencontract, const symbol& sym, uint16_t bps,
+                      uint32_t validFrom, uint32_t cdDuration, const string& remark);
+
     ACTION unallocate(const name& inheritor, const name& tokencontract, const symbol& sym);
 
     ACTION freeze(const name& inheritor, const name& tokencontract, const symbol& sym);
 
+    // --- bulk actions over every inheritance matching the given inheritor / token contract / symbol code,
+    //     empty ones match any; at most limit rows per call, resumed with the printed cursor
+    ACTION bulkfreeze(const name& inheritor, const name& tokencontract, const symbol_code& symc, bool frozen,
+                      uint64_t cursor, uint32_t limit);
+
+    ACTION bulkunalloc(const name& inheritor, const name& tokencontract, const symbol_code& symc,
+                       uint64_t cursor, uint32_t limit);
+
     ACTION setenable(bool enabled);
 
+    ACTION heartbeat();
+
+    ACTION migrate(const vector<name>& inheritors, const vector<name>& tokencontracts, uint32_t limit);
+
+    ACTION migratedone(const vector<name>& inheritors, const vector<name>& tokencontracts);
+
     ACTION onagentmine(const name& inheritor, const name& tokencontract, const asset& quantity,
                        const name& assetclient, const name& miner);
 
+    // --- multi-tenant actions: one deployment serves many owners, each owner grants
+    //     its active permission to this contract's eosio.code
+    ACTION tinit(const name& owner);
+
+    ACTION tallocate(const name& owner, const name& inheritor, const name& tokencontract, const asset& quantity,
+                     uint32_t validFrom, uint32_t cdDuration, const string& remark);
+
+    ACTION tallocshare(const name& owner, const name& inheritor, const name& tokencontract, const symbol& sym,
+                       uint16_t bps, uint32_t validFrom, uint32_t cdDuration, const string& remark);
+
+    ACTION tunallocate(const name& owner, const name& inheritor, const name& tokencontract, const symbol& sym);
+
+    ACTION tfreeze(const name& owner, const name& inheritor, const name& tokencontract, const symbol& sym);
+
+    ACTION tbulkfreeze(const name& owner, const name& inheritor, const name& tokencontract, const symbol_code& symc,
+                       bool frozen, uint64_t cursor, uint32_t limit);
+
+    ACTION tbulkunalloc(const name& owner, const name& inheritor, const name& tokencontract, const symbol_code& symc,
+                        uint64_t cursor, uint32_t limit);
+
+    ACTION tsetenable(const name& owner, bool enabled);
+
+    ACTION theartbeat(const name& owner);
+
+    // --- read only: RAM the owner and this contract would pay to allocate count inheritances of a token
+    //     and to transfer mine them, remarks of remarklen bytes
+    ACTION estimate(const name& owner, const name& tokencontract, const symbol& sym, uint32_t count, uint32_t remarklen);
+
     // --- notification response
     // [[eosio::on_notify("inheritagent::mine")]]
     // void onmine(const name& inheritor, const name& tokencontract, const asset& quantity,
@@ -37,14 +86,27 @@ CONTRACT InheritClt : public contract {
     ACTION clearalloc(const name& tokencontract);
     ACTION cleartrans(const name& tokencontract);
     ACTION printtime();
+    ACTION benchlookup(const vector<name>& inheritors, const name& tokencontract, const symbol_code& symc,
+                       uint32_t rounds);
 #endif
 
   private:  
+    // table layout of the contract account's own inheritance records
+    typedef enum {
+      LEGACY          = 0,  // inheritance scoped by inheritor, allocation scoped by token contract
+      MIGRATING       = 1,  // moving legacy rows, mutating and mining actions are paused, freeze excepted
+      CONSOLIDATED    = 2   // same owner scoped tables as the multi-tenant mode
+    } ELayout;
+
     // global flag enable or disable the inheritance
     TABLE GlobalFlag {
       uint64_t  key;
       bool      miningEnabled;
+      binary_extension<uint8_t> layout;
+      binary_extension<uint32_t> epochOffset;   // seconds all validFrom of the owner are postponed by
+      binary_extension<uint32_t> lastBeat;      // time of the last heartbeat
       uint64_t  primary_key() const { return key; }
+      static constexpr uint32_t fixed_size = 9;     // serialized bytes without the extensions (9 more with all), see RamCost.hpp
     };
     typedef eosio::multi_index<"globalflag"_n, GlobalFlag> GlobalFlagIndex;
 
@@ -68,6 +130,8 @@ CONTRACT InheritClt : public contract {
       string          remark;
       uint64_t  primary_key() const { return id; }
       uint64_t  get_token_code() const { return willGet.contract.value; }
+      static constexpr uint32_t fixed_size = 45;
+      static constexpr uint32_t packed_size(uint32_t remarkLen) { return fixed_size + ramcost::string_size( remarkLen ); }
       uint64_t  get_token_symc() const { return willGet.quantity.symbol.code().raw(); }
       uint128_t get_unique_tkn() const { return ( static_cast<uint128_t>(get_token_code()) << 64 ) | get_token_symc(); }
       uint64_t  get_valid_from() const { return static_cast<uint64_t>(validFrom); }
@@ -91,6 +155,8 @@ CONTRACT InheritClt : public contract {
       uint32_t  transferedTime;
       string    remark;
       uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 48;
+      static constexpr uint32_t packed_size(uint32_t remarkLen) { return fixed_size + ramcost::string_size( remarkLen ); }
       uint64_t  get_token_symc() const { return got.symbol.code().raw(); }
       uint128_t get_rcvr_token() const { return ( static_cast<uint128_t>(receiver.value) << 64 ) | get_token_symc(); }
       uint64_t  get_valid_from() const { return static_cast<uint64_t>(validFrom); }
@@ -108,9 +174,104 @@ CONTRACT InheritClt : public contract {
       asset unallocated;
       asset transfered;
       uint64_t primary_key() const { return unallocated.symbol.code().raw(); }
+      static constexpr uint32_t fixed_size = 48;
     };
     typedef eosio::multi_index<"allocation"_n, Allocation> AllocationIndex;
 
+    // --- multi-tenant table of inheritance records
+    TABLE TntInherit { // scoped by owner
+      uint64_t        id;
+      name            inheritor;
+      State           state;
+      extended_asset  willGet;
+      uint32_t        validFrom;
+      uint32_t        cdBeganTime;
+      uint32_t        cdDuration;
+      string          remark;
+      binary_extension<uint16_t> shareBps;  // share mode: basis points of the unallocated balance, willGet amount 0
+      uint64_t    primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 53;    // without shareBps, 2 more bytes on share rows
+      static constexpr uint32_t packed_size(uint32_t remarkLen, bool share) {
+        return fixed_size + ramcost::string_size( remarkLen ) + ( share ? 2 : 0 );
+      }
+      uint64_t    get_token_code() const { return willGet.contract.value; }
+      uint64_t    get_token_symc() const { return willGet.quantity.symbol.code().raw(); }
+      checksum256 get_inherit_tkn() const { return inherit_tkn( inheritor, willGet.contract, willGet.quantity.symbol.code() ); }
+      uint64_t    get_valid_from() const { return static_cast<uint64_t>(validFrom); }
+      static checksum256 inherit_tkn(const name& inheritor, const name& tokencontract, const symbol_code& symc) {
+        return checksum256::make_from_word_sequence<uint64_t>( inheritor.value, tokencontract.value, symc.raw(), 0ULL );
+      }
+    };
+    typedef eosio::multi_index<
+      "tinherit"_n, TntInherit,
+      indexed_by<"tokencode"_n, const_mem_fun<TntInherit, uint64_t, &TntInherit::get_token_code>>,
+      indexed_by<"tokensymc"_n, const_mem_fun<TntInherit, uint64_t, &TntInherit::get_token_symc>>,
+      indexed_by<"inherittkn"_n, const_mem_fun<TntInherit, checksum256, &TntInherit::get_inherit_tkn>>,
+      indexed_by<"validfrom"_n, const_mem_fun<TntInherit, uint64_t, &TntInherit::get_valid_from>>
+      > TntInheritIndex;
+
+    // storage traits of the inheritance records, see Storage.hpp
+    struct TntInheritRows {
+      using row = TntInherit;
+      using index = TntInheritIndex;
+      using key = checksum256;
+      static constexpr name::raw table = "tinherit"_n;
+      static constexpr name::raw key_index = "inherittkn"_n;
+      static key key_of(const row& r) { return r.get_inherit_tkn(); }
+      // secondary keys the bulk actions walk by, besides the unique key
+      struct by_code {
+        using key = uint64_t;
+        static constexpr name::raw index = "tokencode"_n;
+        static key of(const row& r) { return r.get_token_code(); }
+      };
+      struct by_symc {
+        using key = uint64_t;
+        static constexpr name::raw index = "tokensymc"_n;
+        static key of(const row& r) { return r.get_token_symc(); }
+      };
+      using ranges = std::tuple<by_code, by_symc>;
+    };
+
+    // --- multi-tenant table of transfered after mining
+    TABLE TntTrans { // scoped by owner
+      uint64_t        id;
+      name            receiver;
+      extended_asset  got;
+      uint32_t        validFrom;
+      uint32_t        cdBeganTime;
+      uint32_t        cdDuration;
+      uint32_t        transferedTime;
+      string          remark;
+      uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 56;
+      static constexpr uint32_t packed_size(uint32_t remarkLen) { return fixed_size + ramcost::string_size( remarkLen ); }
+      uint128_t get_rcvr_token() const { return ( static_cast<uint128_t>(receiver.value) << 64 ) | got.quantity.symbol.code().raw(); }
+      uint64_t  get_valid_from() const { return static_cast<uint64_t>(validFrom); }
+    };
+    typedef eosio::multi_index<
+      "ttransfered"_n, TntTrans,
+      indexed_by<"rcvrtoken"_n, const_mem_fun<TntTrans, uint128_t, &TntTrans::get_rcvr_token>>,
+      indexed_by<"validfrom"_n, const_mem_fun<TntTrans, uint64_t, &TntTrans::get_valid_from>>
+      > TntTransIndex;
+
+    // --- multi-tenant table of owner's asset allocated and unallocated
+    TABLE TntAlloc {  // scoped by owner
+      uint64_t  id;
+      name      contract;
+      asset     allocated;
+      asset     unallocated;
+      asset     transfered;
+      binary_extension<uint16_t> shareTotal;  // basis points of all share rows, transfered ones included
+      binary_extension<uint16_t> shareSpent;  // basis points of share rows already transfered
+      uint64_t  primary_key() const { return id; }
+      static constexpr uint32_t fixed_size = 64;    // without the share extensions, 4 more bytes once a share is set
+      uint128_t get_unique_tkn() const { return ( static_cast<uint128_t>(contract.value) << 64 ) | unallocated.symbol.code().raw(); }
+    };
+    typedef eosio::multi_index<
+      "tallocation"_n, TntAlloc,
+      indexed_by<"uniquetkn"_n, const_mem_fun<TntAlloc, uint128_t, &TntAlloc::get_unique_tkn>>
+      > TntAllocIndex;
+
     // --- for indexing external table in eosio.token or eosio.token-like contract
     struct Account {  // same as the struct in eosio.token
       asset balance;
@@ -119,6 +280,29 @@ CONTRACT InheritClt : public contract {
     typedef eosio::multi_index<"accounts"_n, Account> AccountIndex;
 
     // --- helper methods
-    bool _miningEnabled() const;
+    bool _miningEnabled(const name& owner) const;
+    uint8_t _layout() const;
+    uint64_t _flagScope(const name& owner) const;
+    void _epoch(const name& owner, uint32_t& offset, uint32_t& lastBeat) const;
+    void _heartbeat(const name& owner);
+    void _allocate(const name& owner, const name& inheritor, const name& tokencontract, const asset& quantity,
+                   uint32_t validFrom, uint32_t cdDuration, const string& remark);
+    void _allocshare(const name& owner, const name& inheritor, const name& tokencontract, const symbol& sym,
+                     uint16_t bps, uint32_t validFrom, uint32_t cdDuration, const string& remark);
+    void _unallocate(const name& owner, const name& inheritor, const name& tokencontract, const symbol& sym);
+    void _freeze(const name& owner, const name& inheritor, const name& tokencontract, const symbol& sym);
+    typedef enum {
+      BULK_FREEZE     = 0,
+      BULK_UNFREEZE   = 1,
+      BULK_UNALLOCATE = 2
+    } EBulkOp;
+    void _bulk(const name& owner, const name& inheritor, const name& tokencontract, const symbol_code& symc,
+               uint8_t op, uint64_t cursor, uint32_t limit);
+    void _mine(const name& owner, const name& inheritor, const name& tokencontract, const asset& quantity);
+    void _legacyAllocate(const name& inheritor, const name& tokencontract, const asset& quantity,
+                         uint32_t validFrom, uint32_t cdDuration, const string& remark);
+    void _legacyUnallocate(const name& inheritor, const name& tokencontract, const symbol& sym);
+    bool _legacyFreeze(const name& inheritor, const name& tokencontract, const symbol& sym);
+    void _legacyMine(const name& inheritor, const name& tokencontract, const asset& quantity);
     uint32_t _timenow() const { return current_time_point().sec_since_epoch(); }
 };
@@ -0,0 +1,368 @@
+#!/usr/bin/env python3
+"""Billed-resource benchmark of the inheritance contracts on a local single-node chain.
+
+Starts a throw-away single-producer nodeos (no p2p), deploys eosio.token, InheritAgent and
+InheritClt, runs scripted scenarios and records billed CPU (us), NET (bytes) and the RAM
+delta of every touched account for each action into a JSON report. The protocol features the
+node supports, KV_DATABASE among them, are activated first through eosio.boot, so STORAGE_KV
+builds deploy as well.
+
+The micro benchmark isolates the two storage patterns from the rest of the actions: the keyed
+inheritance lookup (InheritClt::benchlookup) and the bill append (InheritAgent::benchbill), both
+DEBUG actions. Each runs with 0 and with --micro-ops operations; the difference of the billed CPU
+divided by the operations is the cost of one operation on the backend the contracts were built with.
+
+  python3 bench/bench.py --token-dir ~/eosio.contracts/build/contracts/eosio.token --out base.json
+  python3 bench/bench.py --token-dir ... --out head.json --compare base.json
+"""
+
+import argparse
+import json
+import os
+import re
+import shutil
+import signal
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+import urllib.request
+
+# digest of PREACTIVATE_FEATURE, scheduled through the producer api before anything else can be activated
+PREACTIVATE_FEATURE = "0ec7e080177b2c02b278d5088611686b49d739925a92d9bfcacd7fc6b74053bd"
+
+# well known development key of the eosio account, only ever used on the throw-away chain
+DEV_PUB = "EOS6MRyAjQq8ud7hVNYcfnVPJqcVpscN5So8BhtHuGYqET5GDW5CV"
+DEV_PRIV = "5KQwrPbwdL6PhXujxW37FSSQZ1JiwsST4cqQzDeyXtP79zkvFD3"
+
+# InheritClt only accepts onagentmine from this account
+AGENT = "inheritagent"
+CLIENT = "client"
+MINER = "miner1"
+TOKEN = "eosio.token"
+SYMBOL = "SYS"
+
+HEAP_PEAK_RE = re.compile(r"heap peak: (\d+)")
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def fmt(amount):
+    return "%.4f %s" % (amount, SYMBOL)
+
+
+class Chain:
+    def __init__(self, args):
+        self.args = args
+        self.workdir = tempfile.mkdtemp(prefix="inherit-bench-")
+        self.url = "http://127.0.0.1:%d" % args.http_port
+        self.wallet_url = "http://127.0.0.1:%d" % args.wallet_port
+        self.procs = []
+
+    # --- process control
+    def start(self):
+        self.procs.append(subprocess.Popen(
+            [self.args.keosd, "--http-server-address", "127.0.0.1:%d" % self.args.wallet_port,
+             "--wallet-dir", os.path.join(self.workdir, "wallet"), "--unlock-timeout", "999999"],
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL))
+        self.procs.append(subprocess.Popen(
+            [self.args.nodeos, "-e", "-p", "eosio",
+             "--data-dir", os.path.join(self.workdir, "data"),
+             "--config-dir", os.path.join(self.workdir, "config"),
+             "--plugin", "eosio::producer_plugin", "--plugin", "eosio::producer_api_plugin",
+             "--plugin", "eosio::chain_api_plugin",
+             "--plugin", "eosio::http_plugin", "--http-server-address", "127.0.0.1:%d" % self.args.http_port,
+             "--p2p-listen-endpoint", "127.0.0.1:0", "--contracts-console",
+             "--max-transaction-time", "1000", "--signature-provider", "%s=KEY:%s" % (DEV_PUB, DEV_PRIV)],
+            stdout=subprocess.DEVNULL, stderr=open(os.path.join(self.workdir, "nodeos.log"), "w")))
+        self._wait_http()
+        self.cleos("wallet", "create", "--to-console")
+        self.cleos("wallet", "import", "--private-key", DEV_PRIV)
+
+    def stop(self):
+        for proc in self.procs:
+            proc.send_signal(signal.SIGINT)
+        for proc in self.procs:
+            try:
+                proc.wait(timeout=10)
+            except subprocess.TimeoutExpired:
+                proc.kill()
+        if not self.args.keep:
+            shutil.rmtree(self.workdir, ignore_errors=True)
+
+    def _wait_http(self):
+        for _ in range(100):
+            try:
+                urllib.request.urlopen(self.url + "/v1/chain/get_info", timeout=1)
+                return
+            except OSError:
+                time.sleep(0.2)
+        sys.exit("nodeos did not come up, see %s" % os.path.join(self.workdir, "nodeos.log"))
+
+    def post(self, path, body):
+        request = urllib.request.Request(self.url + path, data=json.dumps(body).encode(), method="POST")
+        with urllib.request.urlopen(request, timeout=5) as response:
+            return json.loads(response.read() or b"null")
+
+    # --- cleos helpers
+    def cleos(self, *cmd, check=True):
+        result = subprocess.run([self.args.cleos, "-u", self.url, "--wallet-url", self.wallet_url] + list(cmd),
+                                capture_output=True, text=True)
+        if check and result.returncode != 0:
+            sys.exit("cleos %s failed:\n%s" % (" ".join(cmd), result.stderr))
+        return result.stdout
+
+    def ram_usage(self, account):
+        return json.loads(self.cleos("get", "account", account, "-j"))["ram_usage"]
+
+    def push(self, contract, action, data, actor, accounts, unique=False):
+        """push one action and return its billed resources; unique allows pushing the same data again"""
+        before = {a: self.ram_usage(a) for a in accounts}
+        extra = ["--force-unique"] if unique else []
+        out = json.loads(self.cleos("push", "action", contract, action, json.dumps(data), "-p", actor, "-j", *extra))
+        receipt = out["processed"]["receipt"]
+        after = {a: self.ram_usage(a) for a in accounts}
+        sample = {
+            "action": "%s::%s" % (contract, action),
+            "cpu_us": receipt["cpu_usage_us"],
+            "net_bytes": receipt["net_usage_words"] * 8,
+            "ram_delta": {a: after[a] - before[a] for a in accounts},
+        }
+        # DEBUG_PRINT builds of the agent print the wasm heap used by the action
+        peaks = [int(p) for trace in out["processed"]["action_traces"]
+                 for p in HEAP_PEAK_RE.findall(trace.get("console", ""))]
+        if peaks:
+            sample["heap_peak"] = max(peaks)
+        return sample
+
+
+def activate_features(chain, args):
+    """activate every builtin protocol feature the node supports, dependencies first"""
+    chain.post("/v1/producer/schedule_protocol_feature_activations",
+               {"protocol_features_to_activate": [PREACTIVATE_FEATURE]})
+    time.sleep(1.5)     # let a block take the preactivation in
+    chain.cleos("set", "contract", "eosio", args.boot_dir, "-p", "eosio")
+
+    features = {f["feature_digest"]: f for f in chain.post("/v1/producer/get_supported_protocol_features", {})}
+    active = {PREACTIVATE_FEATURE}
+    while True:
+        ready = [d for d, f in features.items() if d not in active and set(f["dependencies"]) <= active]
+        if not ready:
+            break
+        for digest in ready:
+            chain.cleos("push", "action", "eosio", "activate", json.dumps([digest]), "-p", "eosio")
+            active.add(digest)
+        time.sleep(1.5)
+    names = [spec["value"] for f in features.values() for spec in f["specification"]
+             if spec["name"] == "builtin_feature_codename"]
+    if "KV_DATABASE" not in names:
+        print("warning: node does not support KV_DATABASE, STORAGE_KV builds will not deploy", file=sys.stderr)
+
+
+def setup(chain, args):
+    accounts = [TOKEN, AGENT, CLIENT, MINER] + ["inheritor%d" % (i + 1) for i in range(args.inheritors)]
+    for account in accounts:
+        chain.cleos("create", "account", "eosio", account, DEV_PUB, DEV_PUB)
+    chain.cleos("set", "contract", TOKEN, args.token_dir)
+    chain.cleos("push", "action", TOKEN, "create", json.dumps(["eosio", fmt(1e9)]), "-p", TOKEN)
+    for account in (CLIENT, MINER):
+        chain.cleos("push", "action", TOKEN, "issue", json.dumps([account, fmt(100000), ""]), "-p", "eosio")
+
+    chain.cleos("set", "contract", AGENT, os.path.join(args.build_dir, "InheritAgent", "build", "InheritAgent"), "-p", AGENT)
+    chain.cleos("push", "action", AGENT, "init", "[]", "-p", AGENT)
+    chain.cleos("set", "account", "permission", AGENT, "active", "--add-code")
+    chain.cleos("set", "contract", CLIENT, os.path.join(args.build_dir, "InheritClt", "build", "InheritClt"), "-p", CLIENT)
+    chain.cleos("push", "action", CLIENT, "init", "[]", "-p", CLIENT)
+    chain.cleos("set", "account", "permission", CLIENT, "active", "--add-code")
+    chain.cleos("push", "action", CLIENT, "setenable", "[true]", "-p", CLIENT)
+
+
+def transfer(chain, sender, memo, amount, accounts):
+    return chain.push(TOKEN, "transfer", [sender, AGENT, fmt(amount), memo], sender, accounts)
+
+
+def micro(chain, args, inheritors):
+    """billed CPU of one keyed lookup and one bill append, from runs with 0 and with --micro-ops operations"""
+    rounds = max(1, args.micro_ops // len(inheritors))
+    # case: contract, action, operations, action data without and with the operations
+    cases = {
+        "lookup": (CLIENT, "benchlookup", rounds * len(inheritors),
+                   [inheritors, TOKEN, SYMBOL, 0], [inheritors, TOKEN, SYMBOL, rounds]),
+        "bill_append": (AGENT, "benchbill", args.micro_ops, [0], [args.micro_ops]),
+    }
+
+    def cpu(contract, action, data):
+        return statistics.median(chain.push(contract, action, data, contract, [], unique=True)["cpu_us"]
+                                 for _ in range(args.micro_repeat))
+
+    result = {}
+    for case, (contract, action, ops, empty, loaded) in cases.items():
+        base_us, loaded_us = cpu(contract, action, empty), cpu(contract, action, loaded)
+        result[case] = {"ops": ops, "cpu_us_base": base_us, "cpu_us_loaded": loaded_us,
+                        "cpu_us_per_op": (loaded_us - base_us) / ops}
+    return result
+
+
+def share_round(chain, args, watched):
+    """unallocating the last unspent share ends the share round: the next allocshare has the whole 10000 bps again"""
+    now = int(time.time())
+    holder, spender, dropped = "inheritor3", "inheritor1", "inheritor2"
+    samples = [
+        transfer(chain, CLIENT, "client", 10, watched),
+        # a fixed allocation keeps the allocation row of the token alive through the round
+        chain.push(CLIENT, "allocate", [holder, TOKEN, fmt(1), now + 3600, args.cd, "share round"], CLIENT, watched),
+        chain.push(CLIENT, "allocshare", [spender, TOKEN, "4,%s" % SYMBOL, 5000, now - 3600, args.cd, ""], CLIENT, watched),
+        chain.push(CLIENT, "allocshare", [dropped, TOKEN, "4,%s" % SYMBOL, 5000, now - 3600, args.cd, ""], CLIENT, watched),
+        chain.push(AGENT, "mine", [spender, TOKEN, fmt(0), CLIENT, MINER], MINER, watched),
+    ]
+    time.sleep(args.cd + 1)
+    samples += [
+        chain.push(AGENT, "mine", [spender, TOKEN, fmt(0), CLIENT, MINER], MINER, watched, unique=True),
+        chain.push(CLIENT, "unallocate", [dropped, TOKEN, "4,%s" % SYMBOL], CLIENT, watched),
+        chain.push(CLIENT, "allocshare", [dropped, TOKEN, "4,%s" % SYMBOL, 10000, now + 3600, args.cd, ""], CLIENT, watched),
+    ]
+    rows = json.loads(chain.cleos("get", "table", CLIENT, CLIENT, "tallocation", "-j"))["rows"]
+    row = next(r for r in rows if r["contract"] == TOKEN and r["unallocated"].endswith(" " + SYMBOL))
+    if (row.get("shareTotal"), row.get("shareSpent")) != (10000, 0):
+        sys.exit("share round not reset: share total %s, share spent %s" % (row.get("shareTotal"), row.get("shareSpent")))
+    for inheritor in (dropped, holder):
+        samples.append(chain.push(CLIENT, "unallocate", [inheritor, TOKEN, "4,%s" % SYMBOL], CLIENT, watched))
+    return samples
+
+
+def run_scenarios(chain, args):
+    report = {}
+    watched = [AGENT, CLIENT, MINER]
+
+    report["deposit"] = [
+        transfer(chain, MINER, "miner", 1, watched),
+        # one more client deposit per inheritor to cover the service cost of each
+        transfer(chain, CLIENT, "client", 5 * args.inheritors + 5, watched),
+    ]
+
+    now = int(time.time())
+    report["allocate"] = [
+        chain.push(CLIENT, "allocate",
+                   ["inheritor%d" % (i + 1), TOKEN, fmt(1), now - 3600, args.cd, "bench allocation"],
+                   CLIENT, watched)
+        for i in range(args.inheritors)
+    ]
+
+    inheritors = ["inheritor%d" % (i + 1) for i in range(args.inheritors)]
+    micro_result = micro(chain, args, inheritors) if args.micro_ops > 0 else {}
+
+    def mine(i):
+        return chain.push(AGENT, "mine", ["inheritor%d" % (i + 1), TOKEN, fmt(1), CLIENT, MINER], MINER, watched)
+
+    # the miner try count is reset by every successful mining, so the rounds never run into the fine
+    report["mine_cd"] = [mine(i) for i in range(args.inheritors)]
+    time.sleep(args.cd + 1)
+    report["mine_transfer"] = [mine(i) for i in range(args.inheritors)]
+    if args.inheritors >= 3:
+        report["share_round"] = share_round(chain, args, watched)
+
+    report["claim"] = [
+        chain.push(AGENT, "minerclaim", [MINER], MINER, watched),
+        chain.push(AGENT, "clientclaim", [CLIENT], CLIENT, watched),
+    ]
+    return report, micro_result
+
+
+def summarize(report):
+    summary = {}
+    for scenario, samples in report.items():
+        cpu = [s["cpu_us"] for s in samples]
+        summary[scenario] = {
+            "count": len(samples),
+            "cpu_us_median": statistics.median(cpu),
+            "cpu_us_max": max(cpu),
+            "net_bytes_median": statistics.median(s["net_bytes"] for s in samples),
+            "ram_bytes_total": sum(sum(s["ram_delta"].values()) for s in samples),
+        }
+        peaks = [s["heap_peak"] for s in samples if "heap_peak" in s]
+        if peaks:
+            summary[scenario]["heap_peak_max"] = max(peaks)
+    return summary
+
+
+def compare(base, head):
+    print("%-16s %12s %12s %8s %12s %12s" % ("scenario", "base cpu", "head cpu", "cpu %", "base ram", "head ram"))
+    for scenario, cur in head["summary"].items():
+        old = base["summary"].get(scenario)
+        if old is None:
+            print("%-16s %12s %12s" % (scenario, "-", cur["cpu_us_median"]))
+            continue
+        delta = 100.0 * (cur["cpu_us_median"] - old["cpu_us_median"]) / max(old["cpu_us_median"], 1)
+        print("%-16s %12s %12s %+7.1f%% %12s %12s" % (scenario, old["cpu_us_median"], cur["cpu_us_median"], delta,
+                                                      old["ram_bytes_total"], cur["ram_bytes_total"]))
+    heaps = [(scenario, cur["heap_peak_max"]) for scenario, cur in head["summary"].items() if "heap_peak_max" in cur]
+    if heaps:
+        print()
+        print("%-16s %12s %12s" % ("heap peak", "base bytes", "head bytes"))
+        for scenario, peak in heaps:
+            print("%-16s %12s %12s" % (scenario, base["summary"].get(scenario, {}).get("heap_peak_max", "-"), peak))
+    if head.get("micro"):
+        print()
+        print("%-16s %14s %14s %8s" % ("micro", "base us/op", "head us/op", "us/op %"))
+        for case, cur in head["micro"].items():
+            old = base.get("micro", {}).get(case)
+            if old is None:
+                print("%-16s %14s %14.2f" % (case, "-", cur["cpu_us_per_op"]))
+                continue
+            delta = 100.0 * (cur["cpu_us_per_op"] - old["cpu_us_per_op"]) / max(abs(old["cpu_us_per_op"]), 0.01)
+            print("%-16s %14.2f %14.2f %+7.1f%%" % (case, old["cpu_us_per_op"], cur["cpu_us_per_op"], delta))
+
+
+def git_revision():
+    try:
+        return subprocess.run(["git", "-C", ROOT, "rev-parse", "HEAD"], capture_output=True, text=True).stdout.strip()
+    except OSError:
+        return ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--token-dir", required=True, help="directory of the built eosio.token contract")
+    parser.add_argument("--boot-dir", help="directory of the built eosio.boot contract, default next to --token-dir")
+    parser.add_argument("--build-dir", default=ROOT, help="root holding InheritAgent/build and InheritClt/build")
+    parser.add_argument("--nodeos", default="nodeos")
+    parser.add_argument("--cleos", default="cleos")
+    parser.add_argument("--keosd", default="keosd")
+    parser.add_argument("--http-port", type=int, default=18888)
+    parser.add_argument("--wallet-port", type=int, default=18900)
+    parser.add_argument("--inheritors", type=int, default=10, help="N for allocate and mine rounds")
+    parser.add_argument("--cd", type=int, default=2, help="cool down seconds of each allocation")
+    parser.add_argument("--micro-ops", type=int, default=500,
+                        help="operations per micro benchmark run, 0 skips it (needs the contracts built with DEBUG)")
+    parser.add_argument("--micro-repeat", type=int, default=5, help="runs per micro benchmark point, median taken")
+    parser.add_argument("--label", default="", help="free text stored in the report, e.g. a build flavour")
+    parser.add_argument("--out", default="bench_report.json")
+    parser.add_argument("--compare", help="earlier report to compare against")
+    parser.add_argument("--keep", action="store_true", help="keep the chain data directory")
+    args = parser.parse_args()
+    if not args.boot_dir:
+        args.boot_dir = os.path.join(os.path.dirname(os.path.normpath(args.token_dir)), "eosio.boot")
+
+    chain = Chain(args)
+    try:
+        chain.start()
+        activate_features(chain, args)
+        setup(chain, args)
+        report, micro_result = run_scenarios(chain, args)
+    finally:
+        chain.stop()
+
+    result = {"revision": git_revision(), "label": args.label, "inheritors": args.inheritors,
+              "summary": summarize(report), "micro": micro_result, "samples": report}
+    with open(args.out, "w") as f:
+        json.dump(result, f, indent=2)
+    print("report written to %s" % args.out)
+
+    if args.compare:
+        with open(args.compare) as f:
+            compare(json.load(f), result)
+
+
+if __name__ == "__main__":
+    main()
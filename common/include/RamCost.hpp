@@ -0,0 +1,95 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/multi_index.hpp>
+#include <eosio/fixed_bytes.hpp>
+#include <type_traits>
+#include <tuple>
+
+// --- RAM billed for multi_index rows, worked out at compile time from the table declarations.
+//     The chain bills fixed object sizes (billable_size_v in eosio/chain/contract_table_objects.hpp):
+//     a table_id_object for every (code, scope, table) and for every secondary index table of that scope,
+//     created by the first row and released with the last one; a key_value_object plus the serialized
+//     bytes for every row; and an index object for every secondary key of the row.
+//     TABLE structs give the serialized size of their fields but strings, vectors and binary extensions as
+//     fixed_size, checked by tools/rowdecode/rowgen.py --check in the contract builds, plus packed_size(...)
+//     when they hold strings or vectors. Tables behind Storage.hpp take their figures from storage::keyed and
+//     storage::log (row_ram, scope_ram), which use the kv terms below in STORAGE_KV builds.
+namespace ramcost {
+
+constexpr int64_t TABLE_ID_BYTES = 108;
+constexpr int64_t ROW_BYTES = 108;
+constexpr int64_t IDX64_BYTES = 128;
+constexpr int64_t IDX128_BYTES = 136;
+constexpr int64_t IDX256_BYTES = 152;
+constexpr int64_t IDX_DOUBLE_BYTES = 128;
+constexpr int64_t IDX_LONG_DOUBLE_BYTES = 136;
+
+// bytes of a varuint32 length prefix
+constexpr uint32_t varuint_size(uint32_t value) {
+  uint32_t size = 1;
+  for ( ; value >= 0x80; value >>= 7 ) ++size;
+  return size;
+}
+
+// bytes of a serialized string or vector of fixed size elements
+constexpr uint32_t string_size(uint32_t length) { return varuint_size( length ) + length; }
+constexpr uint32_t vector_size(uint32_t count, uint32_t elementSize) { return varuint_size( count ) + count * elementSize; }
+
+template<typename Key>
+constexpr int64_t secondary_bytes() {
+  if constexpr ( std::is_same_v<Key, uint64_t> ) return IDX64_BYTES;
+  else if constexpr ( std::is_same_v<Key, uint128_t> ) return IDX128_BYTES;
+  else if constexpr ( std::is_same_v<Key, eosio::checksum256> ) return IDX256_BYTES;
+  else if constexpr ( std::is_same_v<Key, double> ) return IDX_DOUBLE_BYTES;
+  else {
+    static_assert( std::is_same_v<Key, long double>, "unsupported secondary key type" );
+    return IDX_LONG_DOUBLE_BYTES;
+  }
+}
+
+// --- kv database: an entry is billed as its key and value bytes plus a fixed object overhead, the same as the
+//     key_value_object of a multi_index row, and nothing per scope. kv::table keys lead with the table and index
+//     names; the entry of a secondary key holds the whole primary key as its value.
+constexpr int64_t KV_ENTRY_BYTES = 108;
+constexpr int64_t KV_PREFIX_BYTES = 16;
+
+// bytes of a kv key part
+template<typename Key>
+struct key_bytes;
+template<> struct key_bytes<uint64_t> { static constexpr int64_t value = 8; };
+template<> struct key_bytes<uint128_t> { static constexpr int64_t value = 16; };
+template<> struct key_bytes<eosio::checksum256> { static constexpr int64_t value = 32; };
+template<typename... Parts>
+struct key_bytes<std::tuple<Parts...>> { static constexpr int64_t value = ( int64_t(0) + ... + key_bytes<Parts>::value ); };
+
+constexpr int64_t kv_entry(int64_t keyBytes, int64_t valueBytes) {
+  return KV_ENTRY_BYTES + KV_PREFIX_BYTES + keyBytes + valueBytes;
+}
+
+// a row of the Storage.hpp kv tables: (scope, id) -> (scope, row), and (scope, key) -> primary key per secondary key
+template<typename... SecondaryKeys>
+constexpr int64_t kv_row(uint32_t packedSize) {
+  constexpr int64_t primaryKey = 8 + 8;
+  return kv_entry( primaryKey, 8 + packedSize )
+       + ( int64_t(0) + ... + kv_entry( 8 + key_bytes<SecondaryKeys>::value, KV_PREFIX_BYTES + primaryKey ) );
+}
+
+// costs of one multi_index typedef, its indexed_by entries included
+template<typename Index>
+struct table;
+
+template<eosio::name::raw TableName, typename T, typename... Indices>
+struct table<eosio::multi_index<TableName, T, Indices...>> {
+  static constexpr int64_t secondaries = sizeof...(Indices);
+  static constexpr int64_t index_bytes =
+    ( int64_t(0) + ... + secondary_bytes<std::decay_t<typename Indices::secondary_extractor_type::result_type>>() );
+
+  // one row of the given serialized size
+  static constexpr int64_t row(uint32_t packedSize) { return ROW_BYTES + packedSize + index_bytes; }
+
+  // the table and index tables made by the first row of a scope
+  static constexpr int64_t scope() { return TABLE_ID_BYTES * ( 1 + secondaries ); }
+};
+
+} // namespace ramcost
@@ -0,0 +1,389 @@
+#pragma once
+
+#include <eosio/eosio.hpp>
+#include <eosio/multi_index.hpp>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <RamCost.hpp>
+#ifdef STORAGE_KV
+#include <eosio/table.hpp>
+#endif
+
+// --- thin storage layer over the two access patterns shared by agent and client contracts:
+//     rows looked up by a unique composite key (inheritance) and append-only logs (bills).
+//     By default rows stay in eosio::multi_index with the layout they always had; building with
+//     STORAGE_KV keeps them in eosio::kv::table instead, on chains with the kv database.
+//
+//     Traits of a table:
+//       using row = <TABLE struct>;            row.id is the primary key
+//       using index = <multi_index typedef>;
+//       static constexpr name::raw table;      table name
+//     and for keyed tables additionally:
+//       using key = <unique key type>;
+//       static constexpr name::raw key_index;  multi_index secondary index of the unique key
+//       static key key_of(const row&);
+//       using ranges = std::tuple<Range...>;   optional, further secondary keys the table is walked by, each
+//                                              struct Range { using key; static constexpr name::raw index; static key of(const row&); }
+//     and for logs additionally:
+//       using sort_key = <ordered key type>;
+//       static constexpr name::raw sort_index; multi_index secondary index rows are scanned by
+//       static sort_key sort_of(const row&);
+namespace storage {
+
+using eosio::name;
+
+// the ranges a keyed table declares, none if it declares no Traits::ranges
+template<typename Traits, typename = void>
+struct ranges_of { using type = std::tuple<>; };
+
+template<typename Traits>
+struct ranges_of<Traits, std::void_t<typename Traits::ranges>> { using type = typename Traits::ranges; };
+
+// the unique key of a keyed table walked as a range
+template<typename Traits>
+struct unique_range {
+  using key = typename Traits::key;
+  static constexpr name::raw index = Traits::key_index;
+  static key of(const typename Traits::row& r) { return Traits::key_of( r ); }
+};
+
+#ifndef STORAGE_KV
+
+// --- multi_index backend
+
+template<typename Traits>
+class keyed {
+  public:
+    using row_type = typename Traits::row;
+    using key_type = typename Traits::key;
+
+    keyed(name code, uint64_t scope) : _rows( code, scope ) {}
+
+    // RAM of a row of the given serialized size, and of the tables the first row of a scope makes
+    static constexpr int64_t row_ram(uint32_t packedSize) { return ramcost::table<typename Traits::index>::row( packedSize ); }
+    static constexpr int64_t scope_ram() { return ramcost::table<typename Traits::index>::scope(); }
+
+    // the row in the multi_index cache, nullptr if none; valid while this object lives and the row is not erased
+    const row_type* get(const key_type& key) const {
+      auto keyIndex = _rows.template get_index<Traits::key_index>();
+      auto itr = keyIndex.find( key );
+      if ( itr == keyIndex.end() )
+        return nullptr;
+      return &*itr;
+    }
+
+    // same by row id
+    const row_type* find(uint64_t id) const {
+      auto itr = _rows.find( id );
+      if ( itr == _rows.end() )
+        return nullptr;
+      return &*itr;
+    }
+
+    bool empty() const {
+      return _rows.begin() == _rows.end();
+    }
+
+    // assigns row.id
+    void insert(name payer, row_type& row) {
+      row.id = _rows.available_primary_key();
+      _rows.emplace( payer, [&](auto& r) { r = row; } );
+    }
+
+    void update(name payer, const row_type& row) {
+      _rows.modify( _rows.get( row.id ), payer, [&](auto& r) { r = row; } );
+    }
+
+    // changes a row got from get in place
+    template<typename Mutator>
+    void modify(name payer, const row_type& row, Mutator&& mutate) {
+      _rows.modify( _rows.get( row.id ), payer, mutate );
+    }
+
+    void erase(const row_type& row) {
+      _rows.erase( _rows.get( row.id ) );
+    }
+
+    // visits the rows of the scope in id order while visit returns true
+    template<typename Visitor>
+    void for_each(Visitor&& visit) const {
+      for ( auto itr = _rows.begin(); itr != _rows.end(); ++itr ) {
+        if ( !visit( *itr ) )
+          break;
+      }
+    }
+
+    // visits the rows in Range key order from the first key not below from, or from resume (a row got from
+    // get/find), while visit returns true; visit may modify or erase the row it is given
+    template<typename Range, typename Visitor>
+    void walk(const typename Range::key& from, const row_type* resume, Visitor&& visit) {
+      auto index = _rows.template get_index<Range::index>();
+      auto itr = resume ? index.iterator_to( *resume ) : index.lower_bound( from );
+      while ( itr != index.end() ) {
+        const row_type& row = *itr++;     // step on first, the row may be gone after the visit
+        if ( !visit( row ) )
+          break;
+      }
+    }
+
+  private:
+    typename Traits::index _rows;
+};
+
+template<typename Traits>
+class log {
+  public:
+    using row_type = typename Traits::row;
+    using sort_key_type = typename Traits::sort_key;
+
+    log(name code, uint64_t scope) : _rows( code, scope ) {}
+
+    static constexpr int64_t row_ram(uint32_t packedSize) { return ramcost::table<typename Traits::index>::row( packedSize ); }
+    static constexpr int64_t scope_ram() { return ramcost::table<typename Traits::index>::scope(); }
+
+    bool empty() const {
+      return _rows.begin() == _rows.end();
+    }
+
+    // assigns row.id, returns it
+    uint64_t append(name payer, row_type row) {
+      row.id = _rows.available_primary_key();
+      _rows.emplace( payer, [&](auto& r) { r = row; } );
+      return row.id;
+    }
+
+    // visits up to limit rows with sort key in [from, last], returns the sort key to resume from
+    template<typename Visitor>
+    std::optional<sort_key_type> scan(const sort_key_type& from, const sort_key_type& last, uint32_t limit,
+                                      Visitor&& visit) const {
+      auto sortIndex = _rows.template get_index<Traits::sort_index>();
+      for ( auto itr = sortIndex.lower_bound( from ); itr != sortIndex.end(); ++itr ) {
+        sort_key_type key = Traits::sort_of( *itr );
+        if ( key > last )
+          break;
+        if ( limit-- == 0 )
+          return key;
+        visit( *itr );
+      }
+      return std::nullopt;
+    }
+
+  private:
+    typename Traits::index _rows;
+};
+
+#else
+
+// --- kv::table backend: kv has no scope, so it is stored with the row and leads every key
+
+template<typename Traits>
+struct kv_row {
+  uint64_t              scope;
+  typename Traits::row  row;
+  std::tuple<uint64_t, uint64_t> by_id() const { return { scope, row.id }; }
+  std::tuple<uint64_t, typename Traits::sort_key> by_sort() const { return { scope, Traits::sort_of( row ) }; }
+};
+
+template<typename Traits>
+struct kv_keyed_row {
+  uint64_t              scope;
+  typename Traits::row  row;
+  std::tuple<uint64_t, uint64_t> by_id() const { return { scope, row.id }; }
+  std::tuple<uint64_t, typename Traits::key> by_key() const { return { scope, Traits::key_of( row ) }; }
+  // range keys are not unique, the id makes them so
+  template<typename Range>
+  std::tuple<uint64_t, typename Range::key, uint64_t> by_range() const { return { scope, Range::of( row ), row.id }; }
+};
+
+template<typename Traits>
+struct kv_log_table : eosio::kv::table<kv_row<Traits>, Traits::table> {
+  using base = eosio::kv::table<kv_row<Traits>, Traits::table>;
+  typename base::template index<std::tuple<uint64_t, uint64_t>> id{ name{"id"}, &kv_row<Traits>::by_id };
+  typename base::template index<std::tuple<uint64_t, typename Traits::sort_key>> sort{ name{"sort"}, &kv_row<Traits>::by_sort };
+  kv_log_table(name code) { base::init( code, id, sort ); }
+};
+
+template<typename Traits, typename Ranges = typename ranges_of<Traits>::type>
+struct kv_keyed_table;
+
+template<typename Traits, typename... Ranges>
+struct kv_keyed_table<Traits, std::tuple<Ranges...>> : eosio::kv::table<kv_keyed_row<Traits>, Traits::table> {
+  using base = eosio::kv::table<kv_keyed_row<Traits>, Traits::table>;
+  template<typename Range>
+  using range_index = typename base::template index<std::tuple<uint64_t, typename Range::key, uint64_t>>;
+  typename base::template index<std::tuple<uint64_t, uint64_t>> id{ name{"id"}, &kv_keyed_row<Traits>::by_id };
+  typename base::template index<std::tuple<uint64_t, typename Traits::key>> key{ name{"key"}, &kv_keyed_row<Traits>::by_key };
+  std::tuple<range_index<Ranges>...> ranges{
+    range_index<Ranges>{ name{Ranges::index}, &kv_keyed_row<Traits>::template by_range<Ranges> }... };
+  kv_keyed_table(name code) {
+    std::apply( [&](auto&... range) { base::init( code, id, key, range... ); }, ranges );
+  }
+
+  // the (scope, id) entry, the unique key entry and an entry per range
+  static constexpr int64_t row_ram(uint32_t packedSize) {
+    return ramcost::kv_row<typename Traits::key, std::tuple<typename Ranges::key, uint64_t>...>( packedSize );
+  }
+};
+
+// position of T in a std::tuple of types
+template<typename T, typename Tuple>
+struct tuple_index;
+
+template<typename T, typename... Ts>
+struct tuple_index<T, std::tuple<T, Ts...>> { static constexpr size_t value = 0; };
+
+template<typename T, typename U, typename... Ts>
+struct tuple_index<T, std::tuple<U, Ts...>> { static constexpr size_t value = 1 + tuple_index<T, std::tuple<Ts...>>::value; };
+
+// next free id within a scope, same as multi_index::available_primary_key
+template<typename IdIndex>
+uint64_t kv_next_id(IdIndex& id, uint64_t scope) {
+  auto itr = id.lower_bound( std::make_tuple( scope + 1, uint64_t(0) ) );
+  if ( itr == id.begin() )
+    return 0;
+  --itr;
+  auto last = itr.value();
+  return last.scope == scope ? last.row.id + 1 : 0;
+}
+
+template<typename Traits>
+class keyed {
+  public:
+    using row_type = typename Traits::row;
+    using key_type = typename Traits::key;
+
+    keyed(name code, uint64_t scope) : _rows( code ), _code( code ), _scope( scope ) {}
+
+    // kv has no table objects per scope, a row bills its entries only
+    static constexpr int64_t row_ram(uint32_t packedSize) { return kv_keyed_table<Traits>::row_ram( packedSize ); }
+    static constexpr int64_t scope_ram() { return 0; }
+
+    // kv rows are only read by deserializing, the row is kept here until the next get or find
+    const row_type* get(const key_type& key) const {
+      auto itr = _rows.key.find( std::make_tuple( _scope, key ) );
+      if ( itr == _rows.key.end() )
+        return nullptr;
+      _found = std::move( itr.value().row );
+      return &*_found;
+    }
+
+    const row_type* find(uint64_t id) const {
+      auto itr = _rows.id.find( std::make_tuple( _scope, id ) );
+      if ( itr == _rows.id.end() )
+        return nullptr;
+      _found = std::move( itr.value().row );
+      return &*_found;
+    }
+
+    bool empty() const {
+      auto itr = _rows.id.lower_bound( std::make_tuple( _scope, uint64_t(0) ) );
+      return itr == _rows.id.end() || itr.value().scope != _scope;
+    }
+
+    void insert(name payer, row_type& row) {
+      row.id = kv_next_id( _rows.id, _scope );
+      _rows.put( kv_keyed_row<Traits>{ _scope, row }, payer );
+    }
+
+    // kv has no same_payer, the contract keeps paying for rows it rewrites
+    void update(name payer, const row_type& row) {
+      _rows.put( kv_keyed_row<Traits>{ _scope, row }, payer == eosio::same_payer ? _code : payer );
+    }
+
+    template<typename Mutator>
+    void modify(name payer, const row_type& row, Mutator&& mutate) {
+      row_type changed = row;
+      mutate( changed );
+      update( payer, changed );
+    }
+
+    void erase(const row_type& row) {
+      _rows.erase( kv_keyed_row<Traits>{ _scope, row } );
+    }
+
+    template<typename Visitor>
+    void for_each(Visitor&& visit) const {
+      for ( auto itr = _rows.id.lower_bound( std::make_tuple( _scope, uint64_t(0) ) ); itr != _rows.id.end(); ++itr ) {
+        auto value = itr.value();
+        if ( value.scope != _scope || !visit( value.row ) )
+          break;
+      }
+    }
+
+    // the start key is taken from resume before anything is read, the visited rows are copies
+    template<typename Range, typename Visitor>
+    void walk(const typename Range::key& from, const row_type* resume, Visitor&& visit) {
+      if constexpr ( std::is_same_v<Range, unique_range<Traits>> ) {
+        _walk( _rows.key, std::make_tuple( _scope, resume ? Traits::key_of( *resume ) : from ), visit );
+      }
+      else {
+        auto& index = std::get<tuple_index<Range, typename ranges_of<Traits>::type>::value>( _rows.ranges );
+        _walk( index, resume ? std::make_tuple( _scope, Range::of( *resume ), resume->id )
+                             : std::make_tuple( _scope, from, uint64_t(0) ), visit );
+      }
+    }
+
+  private:
+    template<typename Index, typename Key, typename Visitor>
+    void _walk(Index& index, const Key& start, Visitor& visit) {
+      for ( auto itr = index.lower_bound( start ); itr != index.end(); ) {
+        auto value = itr.value();
+        ++itr;                            // step on first, the row may be gone after the visit
+        if ( value.scope != _scope || !visit( value.row ) )
+          break;
+      }
+    }
+
+    mutable kv_keyed_table<Traits>  _rows;
+    name                            _code;
+    uint64_t                        _scope;
+    mutable std::optional<row_type> _found;
+};
+
+template<typename Traits>
+class log {
+  public:
+    using row_type = typename Traits::row;
+    using sort_key_type = typename Traits::sort_key;
+
+    log(name code, uint64_t scope) : _rows( code ), _scope( scope ) {}
+
+    // the (scope, id) entry and the sort key entry
+    static constexpr int64_t row_ram(uint32_t packedSize) { return ramcost::kv_row<sort_key_type>( packedSize ); }
+    static constexpr int64_t scope_ram() { return 0; }
+
+    bool empty() const {
+      auto itr = _rows.id.lower_bound( std::make_tuple( _scope, uint64_t(0) ) );
+      return itr == _rows.id.end() || itr.value().scope != _scope;
+    }
+
+    uint64_t append(name payer, row_type row) {
+      row.id = kv_next_id( _rows.id, _scope );
+      _rows.put( kv_row<Traits>{ _scope, row }, payer );
+      return row.id;
+    }
+
+    template<typename Visitor>
+    std::optional<sort_key_type> scan(const sort_key_type& from, const sort_key_type& last, uint32_t limit,
+                                      Visitor&& visit) const {
+      for ( auto itr = _rows.sort.lower_bound( std::make_tuple( _scope, from ) ); itr != _rows.sort.end(); ++itr ) {
+        auto value = itr.value();
+        sort_key_type key = Traits::sort_of( value.row );
+        if ( value.scope != _scope || key > last )
+          break;
+        if ( limit-- == 0 )
+          return key;
+        visit( value.row );
+      }
+      return std::nullopt;
+    }
+
+  private:
+    mutable kv_log_table<Traits> _rows;
+    uint64_t                     _scope;
+};
+
+#endif // STORAGE_KV
+
+} // namespace storage
@@ -0,0 +1,130 @@
+// --- decoding cost of one table row: abieos (ABI driven, binary to JSON) against the generated row views.
+//
+//     bench_decode <InheritAgent.abi> <InheritClt.abi> [iterations]
+//
+//     Sample rows are packed from JSON with abieos itself, so both decoders read identical bytes.
+//     The abieos figure is a lower bound for services: they still have to parse the JSON it returns.
+#include <InheritRows.hpp>
+#include <abieos.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace inherit_rows;
+
+struct Sample {
+  const char* abi;        // "agent" or "clt"
+  const char* table;      // table the row is read from, as the snapshot tool keeps it
+  const char* type;       // ABI struct name
+  const char* json;
+};
+
+// the rows the snapshot tool feeds through the views: miner and client bills, and inheritances with and without a share
+static const Sample SAMPLES[] = {
+  { "agent", "minerdata", "MinerData",
+    R"({"miner":"miner1","deposit":"0.1000 SYS","fee":"0.0000 SYS","reward":"2.0000 SYS",)"
+    R"("tryCount":0,"lastTryTime":1600000000,"lastClaimTime":1600000000})" },
+  { "agent", "minerbills", "Bill",
+    R"({"id":42,"account":"miner1","payer":"inheritagent","payee":"miner1","quantity":"1.0000 SYS","type":1,"date":1600000000})" },
+  { "agent", "clientbills", "Bill",
+    R"({"id":43,"account":"client1","payer":"client1","payee":"inheritagent","quantity":"0.0100 SYS","type":2,"date":1600000000})" },
+  { "clt", "tinherit", "TntInherit",
+    R"({"id":7,"inheritor":"inheritor1","state":1,)"
+    R"("willGet":{"quantity":"1.0000 SYS","contract":"eosio.token"},)"
+    R"("validFrom":1600000000,"cdBeganTime":0,"cdDuration":86400,"remark":"bench allocation"})" },
+  { "clt", "tinherit", "TntInherit",
+    R"({"id":8,"inheritor":"inheritor2","state":1,)"
+    R"("willGet":{"quantity":"0.0000 SYS","contract":"eosio.token"},)"
+    R"("validFrom":1600000000,"cdBeganTime":0,"cdDuration":86400,"remark":"bench share","shareBps":5000})" },
+};
+
+static std::string readFile(const char* path) {
+  std::ifstream in( path );
+  if ( !in ) {
+    fprintf( stderr, "cannot read %s\n", path );
+    exit( 1 );
+  }
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// touch every field the way a dashboard would, returns something the optimizer cannot drop
+static uint64_t readAll(const char* type, const char* data, size_t size) {
+  std::string_view t( type );
+  if ( t == "MinerData" ) {
+    agent::MinerData row( data, size );
+    return row.miner() + row.deposit().amount + row.fee().amount + row.reward().amount
+         + row.tryCount() + row.lastTryTime() + row.lastClaimTime();
+  }
+  if ( t == "Bill" ) {
+    agent::Bill row( data, size );
+    return row.id() + row.account() + row.payer() + row.payee() + row.quantity().amount + row.type() + row.date();
+  }
+  clt::TntInherit row( data, size );
+  return row.id() + row.inheritor() + row.state() + row.willGet().quantity.amount + row.willGet().contract
+       + row.validFrom() + row.cdBeganTime() + row.cdDuration() + row.remark().size() + row.shareBps().value_or( 0 );
+}
+
+// the single field lookup services do most, e.g. a balance or a due time
+static uint64_t readOne(const char* type, const char* data, size_t size) {
+  std::string_view t( type );
+  if ( t == "MinerData" ) return agent::MinerData( data, size ).reward().amount;
+  if ( t == "Bill" ) return agent::Bill( data, size ).quantity().amount;
+  return clt::TntInherit( data, size ).validFrom();
+}
+
+template<typename F>
+static double nsPerRow(uint32_t iterations, F&& f) {
+  auto begin = std::chrono::steady_clock::now();
+  for ( uint32_t i = 0; i < iterations; ++i ) f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>( end - begin ).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+  if ( argc < 3 ) {
+    fprintf( stderr, "usage: %s <InheritAgent.abi> <InheritClt.abi> [iterations]\n", argv[0] );
+    return 1;
+  }
+  uint32_t iterations = argc > 3 ? static_cast<uint32_t>( atol( argv[3] ) ) : 1000000;
+
+  abieos_context* ctx = abieos_create();
+  uint64_t agentAbi = abieos_string_to_name( ctx, "agent" );
+  uint64_t cltAbi = abieos_string_to_name( ctx, "clt" );
+  if ( !abieos_set_abi( ctx, agentAbi, readFile( argv[1] ).c_str() )
+    || !abieos_set_abi( ctx, cltAbi, readFile( argv[2] ).c_str() ) ) {
+    fprintf( stderr, "abi: %s\n", abieos_get_error( ctx ) );
+    return 1;
+  }
+
+  printf( "%-12s %-11s %6s %14s %14s %14s %9s\n", "table", "row", "bytes", "abieos ns", "view all ns", "view one ns", "speedup" );
+  volatile uint64_t sink = 0;
+  for ( const auto& sample : SAMPLES ) {
+    uint64_t abi = std::string_view( sample.abi ) == "agent" ? agentAbi : cltAbi;
+    if ( !abieos_json_to_bin( ctx, abi, sample.type, sample.json ) ) {
+      fprintf( stderr, "%s: %s\n", sample.type, abieos_get_error( ctx ) );
+      return 1;
+    }
+    std::vector<char> bin( abieos_get_bin_data( ctx ), abieos_get_bin_data( ctx ) + abieos_get_bin_size( ctx ) );
+    const char* data = bin.data();
+    size_t size = bin.size();
+
+    double abieosNs = nsPerRow( iterations, [&]() {
+      const char* json = abieos_bin_to_json( ctx, abi, sample.type, data, size );
+      sink = sink + ( json ? json[0] : 0 );
+    });
+    double allNs = nsPerRow( iterations, [&]() { sink = sink + readAll( sample.type, data, size ); });
+    double oneNs = nsPerRow( iterations, [&]() { sink = sink + readOne( sample.type, data, size ); });
+
+    printf( "%-12s %-11s %6zu %14.1f %14.1f %14.1f %8.1fx\n", sample.table, sample.type, size, abieosNs, allNs, oneNs, abieosNs / allNs );
+  }
+
+  abieos_destroy( ctx );
+  return 0;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+// --- runtime support of the generated row views (InheritRows.hpp).
+//     A view wraps the raw bytes of one table row as stored on chain (eosio datastream layout,
+//     little endian) and reads fields in place: no ABI, no JSON, no heap.
+namespace inherit_rows {
+
+template<typename T>
+inline T load(const char* p) {
+  T v;
+  std::memcpy( &v, p, sizeof(T) );
+  return v;
+}
+
+// varuint32 as written by eosio::unsigned_int, advances pos
+inline bool read_varuint(const char* data, size_t size, size_t& pos, uint32_t& value) {
+  value = 0;
+  for ( int shift = 0; shift < 35; shift += 7 ) {
+    if ( pos >= size ) return false;
+    uint8_t b = static_cast<uint8_t>( data[pos++] );
+    value |= static_cast<uint32_t>( b & 0x7f ) << shift;
+    if ( !(b & 0x80) ) return true;
+  }
+  return false;
+}
+
+// how visit_fields callers should print a uint64 field
+enum class field_kind { value, name, symbol };
+
+struct asset_view {
+  int64_t   amount;
+  uint64_t  symbol;     // precision in the low byte, symbol code above
+  uint8_t   precision() const { return static_cast<uint8_t>( symbol & 0xff ); }
+  uint64_t  code() const { return symbol >> 8; }
+};
+
+inline asset_view load_asset(const char* p) {
+  return asset_view{ load<int64_t>( p ), load<uint64_t>( p + 8 ) };
+}
+
+struct extended_asset_view {
+  asset_view  quantity;
+  uint64_t    contract;
+};
+
+inline extended_asset_view load_extended_asset(const char* p) {
+  return extended_asset_view{ load_asset( p ), load<uint64_t>( p + 16 ) };
+}
+
+// vector of fixed size rows, elements are views themselves
+template<typename Row>
+class array_view {
+  public:
+    array_view() = default;
+    array_view(const char* data, uint32_t count) : _data( data ), _count( count ) {}
+
+    uint32_t size() const { return _count; }
+    Row operator[](uint32_t i) const { return Row( _data + i * Row::fixed_size, Row::fixed_size ); }
+
+  private:
+    const char* _data = nullptr;
+    uint32_t    _count = 0;
+};
+
+// eosio name to text without allocation, returns the text length (at most 13)
+inline size_t name_to_chars(uint64_t value, char (&out)[13]) {
+  static const char charmap[] = ".12345abcdefghijklmnopqrstuvwxyz";
+  char buf[13];
+  uint64_t tmp = value;
+  for ( int i = 0; i < 13; ++i ) {
+    char c = charmap[tmp & ( i == 0 ? 0x0f : 0x1f )];
+    buf[12 - i] = c;
+    tmp >>= ( i == 0 ? 4 : 5 );
+  }
+  size_t len = 13;
+  while ( len > 0 && buf[len - 1] == '.' ) --len;
+  std::memcpy( out, buf, len );
+  return len;
+}
+
+} // namespace inherit_rows
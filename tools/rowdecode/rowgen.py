@@ -0,0 +1,316 @@
+#!/usr/bin/env python3
+"""Generate native row views from the TABLE structs of the contract headers.
+
+For every TABLE (and plain struct used inside one) a view class is emitted that reads the
+fields of a raw binary row in place. Fields in front of the first variable length field get
+constant offsets, the rest are located by one scan in the view constructor.
+
+The fixed_size literals the TABLE structs declare for RamCost.hpp are checked against the
+serialized layout on every run: fixed_size is the bytes of all fields but strings, vectors and
+binary extensions, which packed_size(...) and the comments add. --check only checks, for the
+contract builds.
+
+  python3 tools/rowdecode/rowgen.py --out InheritRows.hpp \\
+      agent=InheritAgent/include/InheritAgent.hpp clt=InheritClt/include/InheritClt.hpp
+  python3 tools/rowdecode/rowgen.py --check clt=InheritClt/include/InheritClt.hpp
+"""
+
+import argparse
+import re
+import sys
+
+# field type -> (size in bytes, C++ type returned, loader expression with {p} as field address)
+FIXED = {
+    "uint64_t": (8, "uint64_t", "load<uint64_t>( {p} )"),
+    "int64_t": (8, "int64_t", "load<int64_t>( {p} )"),
+    "uint32_t": (4, "uint32_t", "load<uint32_t>( {p} )"),
+    "uint16_t": (2, "uint16_t", "load<uint16_t>( {p} )"),
+    "uint8_t": (1, "uint8_t", "load<uint8_t>( {p} )"),
+    "bool": (1, "bool", "load<uint8_t>( {p} ) != 0"),
+    "name": (8, "uint64_t", "load<uint64_t>( {p} )"),
+    "symbol": (8, "uint64_t", "load<uint64_t>( {p} )"),
+    "asset": (16, "asset_view", "load_asset( {p} )"),
+    "extended_asset": (24, "extended_asset_view", "load_extended_asset( {p} )"),
+}
+
+# fields whose uint64 value is not a plain number, for visit_fields
+KINDS = {"name": "name", "symbol": "symbol"}
+
+STRUCT_RE = re.compile(r"^\s*(?:TABLE|struct)\s+(\w+)\s*\{")
+FIELD_RE = re.compile(r"^\s*([\w:]+(?:<[\w:\s,]+>)?)\s+(\w+)\s*;")
+TYPEDEF_RE = re.compile(r"^\s*typedef\s+([\w:]+)\s+(\w+)\s*;")
+DECLARED_RE = re.compile(r"static\s+constexpr\s+uint32_t\s+fixed_size\s*=\s*(\d+)\s*;")
+TABLE_RE = re.compile(r"multi_index<\s*\"(\w+)\"_n\s*,\s*(\w+)", re.S)
+
+
+def name_value(text):
+    """eosio name string to its uint64 value"""
+    def char_value(c):
+        if "a" <= c <= "z":
+            return ord(c) - ord("a") + 6
+        if "1" <= c <= "5":
+            return ord(c) - ord("1") + 1
+        return 0
+    value = 0
+    for i in range(13):
+        c = char_value(text[i]) if i < len(text) else 0
+        if i < 12:
+            value |= (c & 0x1f) << (64 - 5 * (i + 1))
+        else:
+            value |= c & 0x0f
+    return value
+
+
+def parse_header(path):
+    """returns ([(struct, [(type, field)])], [(table, struct)], {alias: type}, {struct: (fixed_size, line)})"""
+    with open(path) as f:
+        lines = f.read().split("\n")
+    structs, aliases, declared = [], {}, {}
+    i = 0
+    while i < len(lines):
+        m = TYPEDEF_RE.match(lines[i])
+        if m:
+            aliases[m.group(2)] = m.group(1)
+        m = STRUCT_RE.match(lines[i])
+        if not m:
+            i += 1
+            continue
+        fields, depth = [], lines[i].count("{") - lines[i].count("}")
+        i += 1
+        while i < len(lines) and depth > 0:
+            line = lines[i].split("//")[0]
+            d = DECLARED_RE.search(line) if depth == 1 else None
+            if d:
+                declared[m.group(1)] = (int(d.group(1)), i + 1)
+            if depth == 1 and "(" not in line:
+                f = FIELD_RE.match(line)
+                if f:
+                    fields.append((f.group(1).replace(" ", ""), f.group(2)))
+            depth += line.count("{") - line.count("}")
+            i += 1
+        structs.append((m.group(1), fields))
+    with open(path) as f:
+        tables = TABLE_RE.findall(f.read())
+    return structs, tables, aliases, declared
+
+
+class Gen:
+    def __init__(self, structs, aliases):
+        self.aliases = aliases
+        self.sizes = {}         # fixed size of every fully fixed struct
+        for struct, fields in structs:
+            size = 0
+            for ftype, _ in fields:
+                fsize = self.fixed_size(ftype)
+                if fsize is None:
+                    size = None
+                    break
+                size += fsize
+            if size is not None and fields:
+                self.sizes[struct] = size
+
+    def resolve(self, ftype):
+        return self.aliases.get(ftype, ftype)
+
+    def fixed_size(self, ftype):
+        ftype = self.resolve(ftype)
+        if ftype in FIXED:
+            return FIXED[ftype][0]
+        return self.sizes.get(ftype)
+
+    def declared_size(self, struct, fields):
+        """what fixed_size should say: the bytes of every field but strings, vectors and binary extensions"""
+        size = 0
+        for ftype, field in fields:
+            rtype = self.resolve(ftype)
+            if rtype == "string" or re.match(r"(vector|binary_extension)<", rtype):
+                continue
+            fsize = self.fixed_size(rtype)
+            if fsize is None:
+                sys.exit("rowgen: unsupported field type '%s' of %s::%s" % (ftype, struct, field))
+            size += fsize
+        return size
+
+    def struct(self, struct, fields, tables):
+        out = []
+        const_off = 0                   # None once a variable length field is passed
+        scan = []
+        members = []
+        accessors = []
+        visits = []
+        for ftype, field in fields:
+            rtype = self.resolve(ftype)
+            size = self.fixed_size(rtype)
+            ext = re.match(r"binary_extension<(\w+)>$", rtype)
+            vec = re.match(r"vector<(\w+)>$", rtype)
+            kind = KINDS.get(self.resolve(ext.group(1)) if ext else rtype, "value")
+            visits.append('f( "%s", %s(), field_kind::%s );' % (field, field, kind))
+            if size is not None:
+                ret, loader = (FIXED[rtype][1], FIXED[rtype][2]) if rtype in FIXED else (rtype, rtype + "( {p}, %d )" % size)
+                if const_off is not None:
+                    where = "_data + %d" % const_off
+                    const_off += size
+                else:
+                    members.append("size_t  _%s = 0;" % field)
+                    where = "_data + _%s" % field
+                    scan.append("_%s = pos;  pos += %d;" % (field, size))
+                    scan.append("if ( pos > _size ) return false;")
+                accessors.append("%s %s() const { return %s; }" % (ret, field, loader.format(p=where)))
+                continue
+            if const_off is not None:     # the constant prefix is checked once
+                scan.append("size_t pos = %d;" % const_off)
+                scan.append("if ( pos > _size ) return false;")
+                const_off = None
+            if ext:
+                inner = self.resolve(ext.group(1))
+                isize = self.fixed_size(inner)
+                if isize is None:
+                    sys.exit("rowgen: unsupported field type '%s' of %s::%s" % (ftype, struct, field))
+                ret, loader = (FIXED[inner][1], FIXED[inner][2]) if inner in FIXED else (inner, inner + "( {p}, %d )" % isize)
+                members.append("size_t  _%s = 0;" % field)
+                members.append("bool    _has_%s = false;" % field)
+                scan.append("_%s = pos;  _has_%s = pos + %d <= _size;  if ( _has_%s ) pos += %d;"
+                            % (field, field, isize, field, isize))
+                accessors.append("std::optional<%s> %s() const { if ( !_has_%s ) return std::nullopt; return %s; }"
+                                 % (ret, field, field, loader.format(p="_data + _%s" % field)))
+            elif rtype == "string":
+                members.append("size_t  _%s = 0;" % field)
+                members.append("uint32_t _%s_len = 0;" % field)
+                scan.append("if ( !read_varuint( _data, _size, pos, _%s_len ) ) return false;" % field)
+                scan.append("_%s = pos;  pos += _%s_len;" % (field, field))
+                scan.append("if ( pos > _size ) return false;")
+                accessors.append("std::string_view %s() const { return std::string_view( _data + _%s, _%s_len ); }"
+                                 % (field, field, field))
+            elif vec and vec.group(1) in self.sizes:
+                elem = vec.group(1)
+                members.append("size_t  _%s = 0;" % field)
+                members.append("uint32_t _%s_count = 0;" % field)
+                scan.append("if ( !read_varuint( _data, _size, pos, _%s_count ) ) return false;" % field)
+                scan.append("_%s = pos;  pos += size_t( _%s_count ) * %s::fixed_size;" % (field, field, elem))
+                scan.append("if ( pos > _size ) return false;")
+                accessors.append("array_view<%s> %s() const { return array_view<%s>( _data + _%s, _%s_count ); }"
+                                 % (elem, field, elem, field, field))
+            else:
+                sys.exit("rowgen: unsupported field type '%s' of %s::%s" % (ftype, struct, field))
+
+        if const_off is not None:
+            scan.append("size_t pos = %d;" % const_off)
+            scan.append("if ( pos > _size ) return false;")
+
+        fixed = self.sizes.get(struct)
+        comment = "// %s" % struct
+        if tables:
+            comment += ", table " + ", ".join('"%s"' % t for t in tables)
+        out.append(comment)
+        out.append("class %s {" % struct)
+        out.append("  public:")
+        if len(tables) == 1:
+            out.append("    static constexpr uint64_t table = 0x%016xULL;" % name_value(tables[0]))
+        if fixed is not None:
+            out.append("    static constexpr size_t fixed_size = %d;" % fixed)
+        out.append("")
+        out.append("    %s(const char* data, size_t size) : _data( data ), _size( size ) { _valid = _scan(); }" % struct)
+        out.append("")
+        out.append("    // false if the bytes are too short for the row layout")
+        out.append("    bool valid() const { return _valid; }")
+        out.append("")
+        for a in accessors:
+            out.append("    " + a)
+        out.append("")
+        out.append("    // calls f(field, value, kind) for every field in declaration order")
+        out.append("    template<typename F>")
+        out.append("    void visit_fields(F&& f) const {")
+        for v in visits:
+            out.append("      " + v)
+        out.append("    }")
+        out.append("")
+        out.append("  private:")
+        out.append("    bool _scan() {")
+        for s in scan:
+            out.append("      " + s)
+        out.append("      return true;")
+        out.append("    }")
+        out.append("")
+        out.append("    const char* _data;")
+        out.append("    size_t  _size;")
+        out.append("    bool    _valid;")
+        for m in members:
+            out.append("    " + m)
+        out.append("};")
+        out.append("")
+        return out
+
+
+def check(inputs):
+    """mismatches of the declared fixed_size literals, as compiler style messages"""
+    errors = []
+    for _, path in inputs:
+        structs, _, aliases, declared = parse_header(path)
+        gen = Gen(structs, aliases)
+        for struct, fields in structs:
+            if struct not in declared:
+                continue
+            value, line = declared[struct]
+            size = gen.declared_size(struct, fields)
+            if value != size:
+                errors.append("%s:%d: error: %s::fixed_size is %d, its serialized fields add up to %d"
+                              % (path, line, struct, value, size))
+    return errors
+
+
+def generate(inputs):
+    out = [
+        "// generated by tools/rowdecode/rowgen.py from the contract headers, do not edit",
+        "#pragma once",
+        "",
+        "#include <RowView.hpp>",
+        "",
+        "namespace inherit_rows {",
+        "",
+    ]
+    for ns, path in inputs:
+        structs, tables, aliases, _ = parse_header(path)
+        gen = Gen(structs, aliases)
+        out.append("namespace %s {  // %s" % (ns, path))
+        out.append("")
+        for struct, fields in structs:
+            if fields:          # storage traits and other field-less structs have no rows
+                out.extend(gen.struct(struct, fields, [t for t, s in tables if s == struct]))
+        # table name -> view, for tools walking rows of any table
+        out.append("// calls visit(view) with the view of the given table, false for an unknown table")
+        out.append("template<typename Visitor>")
+        out.append("bool dispatch(uint64_t table, const char* data, size_t size, Visitor&& visit) {")
+        out.append("  switch ( table ) {")
+        for table, struct in tables:
+            out.append("    case 0x%016xULL: visit( %s( data, size ) ); return true;  // \"%s\"" % (name_value(table), struct, table))
+        out.append("    default: return false;")
+        out.append("  }")
+        out.append("}")
+        out.append("")
+        out.append("} // namespace %s" % ns)
+        out.append("")
+    out.append("} // namespace inherit_rows")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--out", help="generated header")
+    parser.add_argument("--check", action="store_true", help="only check the fixed_size literals")
+    parser.add_argument("headers", nargs="+", help="namespace=contract header")
+    args = parser.parse_args()
+    if not args.out and not args.check:
+        parser.error("--out or --check is required")
+    inputs = [h.split("=", 1) for h in args.headers]
+    errors = check(inputs)
+    if errors:
+        sys.exit("\n".join(errors))
+    if args.check:
+        return
+    text = generate(inputs)
+    with open(args.out, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()
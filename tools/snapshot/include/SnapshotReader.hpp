@@ -0,0 +1,234 @@
+#pragma once
+
+#include <RowView.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// --- reader of nodeos binary snapshots (snapshot-<block id>.bin, the portable snapshot format).
+//     The file is memory mapped and walked once: sections other than "contract_tables" are skipped by
+//     their size, tables of other accounts by their row sizes, and the rows that are kept are byte ranges
+//     of the mapping, ready for the inherit_rows views. Nothing is copied or decoded up front.
+//
+//     Layout, all integers little endian:
+//       header   uint32 magic 0x30510550, uint32 version
+//       section  uint64 size (of what follows it), uint64 row count, section name NUL terminated, rows
+//       end      uint64 0xffffffffffffffff
+//     "contract_tables" rows are, for every table (code, scope, table):
+//       table_id        code, scope, table, payer (uint64 each), uint32 count
+//       primary rows    varuint count, then (uint64 primary key, uint64 payer, varuint size, bytes)
+//       5 indices       varuint count, then (uint64 primary key, uint64 payer, secondary key) of the
+//                       idx64, idx128, idx256, idx_double, idx_long_double secondary key sizes
+//     Tables of the kv database (STORAGE_KV builds) are in other sections and are not read here.
+namespace inherit_snapshot {
+
+constexpr uint32_t SNAPSHOT_MAGIC = 0x30510550;
+constexpr uint32_t SNAPSHOT_MIN_VERSION = 1;
+constexpr uint32_t SNAPSHOT_MAX_VERSION = 6;
+constexpr uint64_t SECTION_END = ~0ULL;
+
+// secondary key size of idx64, idx128, idx256, idx_double, idx_long_double
+constexpr size_t SECONDARY_KEY_SIZES[] = { 8, 16, 32, 8, 16 };
+
+// eosio name text to its value, e.g. for command line account lists
+constexpr uint64_t name_value(std::string_view text) {
+  uint64_t value = 0;
+  for ( size_t i = 0; i < 13; ++i ) {
+    char c = i < text.size() ? text[i] : '.';
+    uint64_t v = ( c >= 'a' && c <= 'z' ) ? c - 'a' + 6 : ( c >= '1' && c <= '5' ) ? c - '1' + 1 : 0;
+    value |= i < 12 ? ( v & 0x1f ) << ( 64 - 5 * ( i + 1 ) ) : v & 0x0f;
+  }
+  return value;
+}
+
+// one primary row of a contract table, data points into the mapping
+struct table_row {
+  uint64_t    code;
+  uint64_t    scope;
+  uint64_t    table;
+  uint64_t    primary_key;
+  uint64_t    payer;
+  const char* data;
+  uint32_t    size;
+};
+
+// read only mapping of a whole file
+class mapped_file {
+  public:
+    explicit mapped_file(const std::string& path) {
+      int fd = ::open( path.c_str(), O_RDONLY );
+      if ( fd < 0 ) throw std::runtime_error( "cannot open " + path );
+      struct stat st;
+      if ( ::fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+        ::close( fd );
+        throw std::runtime_error( "cannot stat or empty " + path );
+      }
+      _size = static_cast<size_t>( st.st_size );
+      void* addr = ::mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+      ::close( fd );
+      if ( addr == MAP_FAILED ) throw std::runtime_error( "cannot map " + path );
+      ::madvise( addr, _size, MADV_SEQUENTIAL );
+      _data = static_cast<const char*>( addr );
+    }
+    ~mapped_file() { ::munmap( const_cast<char*>( _data ), _size ); }
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    const char* data() const { return _data; }
+    size_t size() const { return _size; }
+
+  private:
+    const char* _data = nullptr;
+    size_t      _size = 0;
+};
+
+class snapshot_reader {
+  public:
+    explicit snapshot_reader(const std::string& path) : _file( path ) {
+      if ( _file.size() < 8 || inherit_rows::load<uint32_t>( _file.data() ) != SNAPSHOT_MAGIC )
+        throw std::runtime_error( path + " is not a binary snapshot" );
+      _version = inherit_rows::load<uint32_t>( _file.data() + 4 );
+      if ( _version < SNAPSHOT_MIN_VERSION || _version > SNAPSHOT_MAX_VERSION )
+        throw std::runtime_error( "unsupported snapshot version " + std::to_string( _version ) );
+    }
+
+    uint32_t version() const { return _version; }
+
+    // calls visit(name, data, size) for every section, data is the first row
+    template<typename Visitor>
+    void sections(Visitor&& visit) const {
+      const char* base = _file.data();
+      size_t pos = 8;
+      while ( true ) {
+        _need( pos, 8 );
+        uint64_t size = inherit_rows::load<uint64_t>( base + pos );
+        if ( size == SECTION_END ) return;
+        pos += 8;
+        _need( pos, size );
+        size_t end = pos + size;
+        size_t name = pos + 8;                  // after the row count
+        size_t nul = name;
+        while ( nul < end && base[nul] != 0 ) ++nul;
+        if ( nul == end ) throw std::runtime_error( "snapshot section name not terminated" );
+        visit( std::string_view( base + name, nul - name ), base + nul + 1, end - nul - 1 );
+        pos = end;
+      }
+    }
+
+    // calls visit(table_row) for every primary row of the tables for which accept(code, table) is true
+    template<typename Filter, typename Visitor>
+    void contract_rows(Filter&& accept, Visitor&& visit) const {
+      bool found = false;
+      sections( [&](std::string_view name, const char* data, size_t size) {
+        if ( name != "contract_tables" ) return;
+        found = true;
+        _walkTables( data, size, accept, visit );
+      });
+      if ( !found ) throw std::runtime_error( "snapshot has no contract_tables section" );
+    }
+
+  private:
+    void _need(size_t pos, uint64_t size) const {
+      if ( size > _file.size() || pos > _file.size() - size ) throw std::runtime_error( "truncated snapshot" );
+    }
+
+    template<typename Filter, typename Visitor>
+    static void _walkTables(const char* data, size_t size, Filter& accept, Visitor& visit) {
+      using inherit_rows::load;
+      auto fail = []() { throw std::runtime_error( "malformed contract_tables section" ); };
+      size_t pos = 0;
+      while ( pos < size ) {
+        if ( size - pos < 36 ) fail();
+        table_row row{ load<uint64_t>( data + pos ), load<uint64_t>( data + pos + 8 ), load<uint64_t>( data + pos + 16 ),
+                       0, 0, nullptr, 0 };
+        pos += 36;                              // table_id: code, scope, table, payer, count
+
+        bool keep = accept( row.code, row.table );
+        uint32_t count = 0;
+        if ( !inherit_rows::read_varuint( data, size, pos, count ) ) fail();
+        for ( uint32_t i = 0; i < count; ++i ) {
+          if ( size - pos < 16 ) fail();
+          row.primary_key = load<uint64_t>( data + pos );
+          row.payer = load<uint64_t>( data + pos + 8 );
+          pos += 16;
+          if ( !inherit_rows::read_varuint( data, size, pos, row.size ) || size - pos < row.size ) fail();
+          row.data = data + pos;
+          pos += row.size;
+          if ( keep ) visit( static_cast<const table_row&>( row ) );
+        }
+
+        // secondary index rows are not needed, indices are rebuilt from the rows
+        for ( size_t keySize : SECONDARY_KEY_SIZES ) {
+          if ( !inherit_rows::read_varuint( data, size, pos, count ) ) fail();
+          uint64_t bytes = uint64_t( count ) * ( 16 + keySize );
+          if ( bytes > size - pos ) fail();
+          pos += bytes;
+        }
+      }
+    }
+
+    mapped_file _file;
+    uint32_t    _version = 0;
+};
+
+// rows of the configured accounts and tables, grouped by (code, table); valid while the reader lives
+class table_store {
+  public:
+    // the contract tables services bootstrap from, agent and client contracts
+    static std::vector<uint64_t> default_tables() {
+      return {
+        name_value( "inheritance" ), name_value( "allocation" ), name_value( "transfered" ),
+        name_value( "tinherit" ), name_value( "tallocation" ), name_value( "ttransfered" ),
+        name_value( "minerdata" ), name_value( "clientdata" ),
+        name_value( "minerbill" ), name_value( "clientbill" ), name_value( "minerbills" ), name_value( "clientbills" ),
+      };
+    }
+
+    table_store(const std::vector<uint64_t>& accounts, const std::vector<uint64_t>& tables)
+      : _accounts( accounts.begin(), accounts.end() ), _tables( tables.begin(), tables.end() ) {}
+
+    // one pass over the snapshot, returns the number of rows kept
+    size_t load(const snapshot_reader& reader) {
+      size_t kept = 0;
+      reader.contract_rows(
+        [this](uint64_t code, uint64_t table) { return _accounts.count( code ) && _tables.count( table ); },
+        [this, &kept](const table_row& row) {
+          _rows[_key( row.code, row.table )].push_back( row );
+          ++kept;
+        });
+      return kept;
+    }
+
+    const std::vector<table_row>& rows(uint64_t code, uint64_t table) const {
+      static const std::vector<table_row> none;
+      auto it = _rows.find( _key( code, table ) );
+      return it == _rows.end() ? none : it->second;
+    }
+
+  private:
+    struct key_hash {
+      size_t operator()(const std::pair<uint64_t, uint64_t>& k) const {
+        return std::hash<uint64_t>()( k.first * 0x9e3779b97f4a7c15ULL ^ k.second );
+      }
+    };
+    static std::pair<uint64_t, uint64_t> _key(uint64_t code, uint64_t table) { return { code, table }; }
+
+    std::unordered_set<uint64_t> _accounts;
+    std::unordered_set<uint64_t> _tables;
+    std::unordered_map<std::pair<uint64_t, uint64_t>, std::vector<table_row>, key_hash> _rows;
+};
+
+} // namespace inherit_snapshot
@@ -0,0 +1,180 @@
+// --- contract state of the agent and client contracts out of a nodeos snapshot, without RPC.
+//
+//     snapshot_extract <snapshot.bin> [--agent name]... [--client name]... [--table name]... [--json]
+//
+//     Prints the row count of every extracted table. With --json every row is written to stdout as one
+//     JSON line, decoded by the generated row views, for indexers and miners to load their stores from.
+#include <InheritRows.hpp>
+#include <SnapshotReader.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace inherit_rows;
+using namespace inherit_snapshot;
+
+static void putName(uint64_t value) {
+  char text[13];
+  size_t len = name_to_chars( value, text );
+  printf( "\"%.*s\"", static_cast<int>( len ), text );
+}
+
+static void putSymbolCode(uint64_t code) {
+  for ( ; code; code >>= 8 ) putchar( static_cast<char>( code & 0xff ) );
+}
+
+static void putAsset(const asset_view& a) {
+  uint64_t scale = 1;
+  for ( uint8_t i = 0; i < a.precision(); ++i ) scale *= 10;
+  uint64_t units = a.amount < 0 ? 0 - static_cast<uint64_t>( a.amount ) : static_cast<uint64_t>( a.amount );
+  printf( "\"%s%" PRIu64, a.amount < 0 ? "-" : "", units / scale );
+  if ( a.precision() > 0 ) printf( ".%0*" PRIu64, a.precision(), units % scale );
+  printf( " " );
+  putSymbolCode( a.code() );
+  printf( "\"" );
+}
+
+static void putString(std::string_view s) {
+  putchar( '"' );
+  for ( char c : s ) {
+    if ( c == '"' || c == '\\' ) printf( "\\%c", c );
+    else if ( static_cast<unsigned char>( c ) < 0x20 ) printf( "\\u%04x", c );
+    else putchar( c );
+  }
+  putchar( '"' );
+}
+
+template<typename View>
+static void putView(const View& view);
+
+template<typename T>
+static void putValue(const T& value, field_kind kind) {
+  if constexpr ( std::is_same_v<T, bool> ) {
+    printf( value ? "true" : "false" );
+  } else if constexpr ( std::is_integral_v<T> ) {
+    if ( kind == field_kind::name ) putName( value );
+    else if ( kind == field_kind::symbol ) {
+      printf( "\"%u,", static_cast<unsigned>( value & 0xff ) );
+      putSymbolCode( static_cast<uint64_t>( value ) >> 8 );
+      printf( "\"" );
+    }
+    else if constexpr ( std::is_signed_v<T> ) printf( "%" PRId64, static_cast<int64_t>( value ) );
+    else printf( "%" PRIu64, static_cast<uint64_t>( value ) );
+  } else if constexpr ( std::is_same_v<T, asset_view> ) {
+    putAsset( value );
+  } else if constexpr ( std::is_same_v<T, extended_asset_view> ) {
+    printf( "{\"quantity\":" );
+    putAsset( value.quantity );
+    printf( ",\"contract\":" );
+    putName( value.contract );
+    printf( "}" );
+  } else if constexpr ( std::is_same_v<T, std::string_view> ) {
+    putString( value );
+  } else {
+    putView( value );
+  }
+}
+
+template<typename T>
+static void putValue(const std::optional<T>& value, field_kind kind) {
+  if ( value ) putValue( *value, kind );
+  else printf( "null" );
+}
+
+template<typename Row>
+static void putValue(const array_view<Row>& values, field_kind) {
+  putchar( '[' );
+  for ( uint32_t i = 0; i < values.size(); ++i ) {
+    if ( i ) putchar( ',' );
+    putView( values[i] );
+  }
+  putchar( ']' );
+}
+
+template<typename View>
+static void putView(const View& view) {
+  bool first = true;
+  putchar( '{' );
+  view.visit_fields( [&first](const char* field, const auto& value, field_kind kind) {
+    printf( "%s\"%s\":", first ? "" : ",", field );
+    putValue( value, kind );
+    first = false;
+  });
+  putchar( '}' );
+}
+
+static void putRow(const table_row& row, bool agent) {
+  printf( "{\"code\":" );
+  putName( row.code );
+  printf( ",\"scope\":" );
+  putName( row.scope );
+  printf( ",\"table\":" );
+  putName( row.table );
+  printf( ",\"primary_key\":%" PRIu64 ",\"payer\":", row.primary_key );
+  putName( row.payer );
+  printf( ",\"row\":" );
+  auto visit = [](const auto& view) {
+    if ( view.valid() ) putView( view );
+    else printf( "null" );
+  };
+  bool known = agent ? agent::dispatch( row.table, row.data, row.size, visit )
+                     : clt::dispatch( row.table, row.data, row.size, visit );
+  if ( !known ) printf( "null" );
+  printf( "}\n" );
+}
+
+int main(int argc, char** argv) {
+  if ( argc < 2 ) {
+    fprintf( stderr, "usage: %s <snapshot.bin> [--agent name]... [--client name]... [--table name]... [--json]\n", argv[0] );
+    return 1;
+  }
+  std::vector<uint64_t> agents, clients, tables;
+  bool json = false;
+  for ( int i = 2; i < argc; ++i ) {
+    std::string_view arg( argv[i] );
+    if ( arg == "--json" ) json = true;
+    else if ( i + 1 < argc && arg == "--agent" ) agents.push_back( name_value( argv[++i] ) );
+    else if ( i + 1 < argc && arg == "--client" ) clients.push_back( name_value( argv[++i] ) );
+    else if ( i + 1 < argc && arg == "--table" ) tables.push_back( name_value( argv[++i] ) );
+    else {
+      fprintf( stderr, "unknown argument %s\n", argv[i] );
+      return 1;
+    }
+  }
+  if ( tables.empty() ) tables = table_store::default_tables();
+  std::vector<uint64_t> accounts( agents );
+  accounts.insert( accounts.end(), clients.begin(), clients.end() );
+
+  try {
+    snapshot_reader reader( argv[1] );
+    table_store store( accounts, tables );
+    size_t kept = store.load( reader );
+    fprintf( stderr, "snapshot version %u, %zu rows extracted\n", reader.version(), kept );
+
+    for ( uint64_t account : accounts ) {
+      bool agent = std::find( agents.begin(), agents.end(), account ) != agents.end();
+      for ( uint64_t table : tables ) {
+        const auto& rows = store.rows( account, table );
+        if ( rows.empty() ) continue;
+        char code[13], name[13];
+        size_t codeLen = name_to_chars( account, code ), nameLen = name_to_chars( table, name );
+        fprintf( stderr, "  %-12.*s %-12.*s %zu\n", static_cast<int>( codeLen ), code,
+                 static_cast<int>( nameLen ), name, rows.size() );
+        if ( json ) {
+          for ( const auto& row : rows ) putRow( row, agent );
+        }
+      }
+    }
+  } catch ( const std::exception& e ) {
+    fprintf( stderr, "%s\n", e.what() );
+    return 1;
+  }
+  return 0;
+}